@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_CLUSTER_PIPELINE_H_
+#define _ZIM_TOOL_CLUSTER_PIPELINE_H_
+
+// The cluster API of zim::Archive is private
+#ifndef ZIM_PRIVATE
+#error "cluster_pipeline.h needs ZIM_PRIVATE defined before <zim/archive.h>"
+#endif
+
+#include <zim/archive.h>
+#include <zim/blob.h>
+#include <zim/entry.h>
+#include <zim/item.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Offsets and sizes of the (compressed) clusters of a ZIM file.
+//
+// A cluster ends where the next one (in the order of the file) starts, the
+// last one ends at the checksum.
+class ClusterRanges
+{
+public: // functions
+    explicit ClusterRanges(const zim::Archive& archive)
+    {
+        const auto clusterCount = archive.getClusterCount();
+        for ( zim::cluster_index_type i = 0; i < clusterCount; ++i )
+            offsets.push_back(archive.getClusterOffset(i));
+
+        std::vector<uint64_t> sortedOffsets(offsets);
+        std::sort(sortedOffsets.begin(), sortedOffsets.end());
+        const uint64_t end = archive.getFilesize() - (archive.hasChecksum() ? 16 : 0);
+        for ( const auto offset : offsets ) {
+            const auto next = std::upper_bound(sortedOffsets.begin(), sortedOffsets.end(), offset);
+            sizes.push_back((next != sortedOffsets.end() ? *next : end) - offset);
+        }
+    }
+
+    size_t count() const { return offsets.size(); }
+    uint64_t offset(zim::cluster_index_type cluster) const { return offsets.at(cluster); }
+    uint64_t size(zim::cluster_index_type cluster) const { return sizes.at(cluster); }
+
+private: // data
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> sizes;
+};
+
+// Advises the operating system to read ahead parts of a file. Does nothing
+// where the advice isn't supported, or if the file can't be opened (e.g. a
+// ZIM file split in several parts).
+class FileReadahead
+{
+public: // functions
+    explicit FileReadahead(const std::string& path)
+    {
+#ifdef POSIX_FADV_WILLNEED
+        fd = ::open(path.c_str(), O_RDONLY);
+#else
+        (void)path;
+#endif
+    }
+
+    ~FileReadahead()
+    {
+#ifndef _WIN32
+        if ( fd != -1 )
+            ::close(fd);
+#endif
+    }
+
+    FileReadahead(const FileReadahead&) = delete;
+    FileReadahead& operator=(const FileReadahead&) = delete;
+
+    void willNeed(uint64_t offset, uint64_t size)
+    {
+#ifdef POSIX_FADV_WILLNEED
+        if ( fd != -1 )
+            posix_fadvise(fd, offset, size, POSIX_FADV_WILLNEED);
+#else
+        (void)offset;
+        (void)size;
+#endif
+    }
+
+private: // data
+    int fd = -1;
+};
+
+// Scans the entries of an archive cluster by cluster, in the order of
+// zim::Archive::iterEfficient(), while the upcoming clusters are prepared:
+// their bytes are read ahead by the operating system and (if there are
+// helper threads) the content of their items is read, thus decompressed,
+// on the helper threads.
+//
+// The groups of entries are returned in order by next(), which blocks
+// until the content of the next group is ready. The content of a group is
+// held by its blobs, so it remains valid however many clusters libzim keeps
+// in its own cache.
+class ClusterPipeline
+{
+public: // types
+    // Consecutive entries stored in the same cluster (the redirections are
+    // grouped as if they were in cluster 0). The entries of a cluster are
+    // split into several groups of at most Options::max_group_entries, so
+    // that the (possibly millions of) redirections aren't held at once.
+    struct Group
+    {
+        zim::cluster_index_type cluster = 0;
+        std::vector<zim::Entry> entries;
+
+        // Content of the selected items (an empty blob for the other
+        // entries), or no blobs at all without helper threads
+        std::vector<zim::Blob> blobs;
+    };
+
+    // Selects the items whose content is read ahead
+    typedef std::function<bool(const zim::Item& item)> Filter;
+
+    struct Options
+    {
+        // Threads reading the content of the items, none for a read ahead
+        // of the bytes of the clusters only
+        unsigned helper_threads = 2;
+
+        // Count of groups prepared ahead of the one being consumed
+        size_t lookahead = 8;
+
+        // Maximal count of entries of a group
+        size_t max_group_entries = 1024;
+
+        // All the items are selected if not set
+        Filter filter;
+    };
+
+public: // functions
+    explicit ClusterPipeline(const zim::Archive& archive)
+        : ClusterPipeline(archive, Options())
+    {}
+
+    ClusterPipeline(const zim::Archive& archive, Options options)
+        : options(std::move(options))
+        , ranges(archive)
+        , readahead(archive.getFilename())
+        , entries(archive.iterEfficient())
+        , it(entries.begin())
+        , end(entries.end())
+    {
+        this->options.lookahead = std::max<size_t>(this->options.lookahead, 1);
+        this->options.max_group_entries = std::max<size_t>(this->options.max_group_entries, 1);
+        for ( unsigned i = 0; i < this->options.helper_threads; ++i )
+            helpers.emplace_back([this]() { this->runHelper(); });
+    }
+
+    ~ClusterPipeline()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        helperCV.notify_all();
+        for ( auto& t : helpers )
+            t.join();
+    }
+
+    ClusterPipeline(const ClusterPipeline&) = delete;
+    ClusterPipeline& operator=(const ClusterPipeline&) = delete;
+
+    // Gets the next group of entries, returns false at the end of the
+    // archive. The exception thrown while reading the content of the group
+    // (if any) is rethrown.
+    bool next(Group& group)
+    {
+        fill();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if ( window.empty() )
+            return false;
+        const auto slot = window.front();
+        window.pop_front();
+        readyCV.wait(lock, [&slot]() { return slot->ready; });
+        lock.unlock();
+
+        if ( slot->error )
+            std::rethrow_exception(slot->error);
+        group = std::move(slot->group);
+        return true;
+    }
+
+private: // types
+    struct Slot
+    {
+        Group group;
+        bool ready = false;
+        std::exception_ptr error;
+    };
+
+private: // functions
+    static zim::cluster_index_type clusterOf(const zim::Entry& entry)
+    {
+        return entry.isRedirect() ? 0 : entry.getItem().getClusterIndex();
+    }
+
+    // Prepares groups up to the lookahead (only the consumer iterates over
+    // the entries)
+    void fill()
+    {
+        while ( it != end ) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if ( window.size() >= options.lookahead )
+                    return;
+            }
+
+            auto slot = std::make_shared<Slot>();
+            Group& group = slot->group;
+            group.cluster = clusterOf(*it);
+            bool hasItems = false;
+            for ( ; it != end && clusterOf(*it) == group.cluster
+                    && group.entries.size() < options.max_group_entries; ++it ) {
+                hasItems = hasItems || !it->isRedirect();
+                group.entries.push_back(*it);
+            }
+            // A cluster split into several groups is read ahead only once
+            if ( hasItems && group.cluster < ranges.count() && group.cluster != readaheadCluster ) {
+                readahead.willNeed(ranges.offset(group.cluster), ranges.size(group.cluster));
+                readaheadCluster = group.cluster;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            window.push_back(slot);
+            if ( helpers.empty() ) {
+                slot->ready = true;
+            } else {
+                todo.push_back(slot);
+                helperCV.notify_one();
+            }
+        }
+    }
+
+    void load(Group& group) const
+    {
+        group.blobs.resize(group.entries.size());
+        for ( size_t i = 0; i < group.entries.size(); ++i ) {
+            const auto& entry = group.entries[i];
+            if ( entry.isRedirect() )
+                continue;
+            const auto item = entry.getItem();
+            if ( !options.filter || options.filter(item) )
+                group.blobs[i] = item.getData();
+        }
+    }
+
+    void runHelper()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while ( true ) {
+            helperCV.wait(lock, [this]() { return stopping || !todo.empty(); });
+            if ( stopping )
+                return;
+            const auto slot = todo.front();
+            todo.pop_front();
+            lock.unlock();
+
+            try {
+                load(slot->group);
+            } catch (...) {
+                slot->error = std::current_exception();
+            }
+
+            lock.lock();
+            slot->ready = true;
+            readyCV.notify_all();
+        }
+    }
+
+private: // data
+    Options options;
+    const ClusterRanges ranges;
+    FileReadahead readahead;
+
+    // Accessed only by the consumer
+    const zim::Archive::EntryRange<zim::EntryOrder::efficientOrder> entries;
+    zim::Archive::iterator<zim::EntryOrder::efficientOrder> it;
+    const zim::Archive::iterator<zim::EntryOrder::efficientOrder> end;
+    zim::cluster_index_type readaheadCluster = zim::cluster_index_type(-1);
+
+    // The groups prepared ahead (in order) and those waiting for a helper
+    // thread are protected by mutex. The consumer waits on readyCV, the
+    // helper threads on helperCV.
+    std::mutex mutex;
+    std::condition_variable readyCV;
+    std::condition_variable helperCV;
+    std::deque<std::shared_ptr<Slot>> window;
+    std::deque<std::shared_ptr<Slot>> todo;
+    bool stopping = false;
+
+    std::vector<std::thread> helpers;
+};
+
+#endif // _ZIM_TOOL_CLUSTER_PIPELINE_H_
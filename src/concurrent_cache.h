@@ -22,8 +22,13 @@
 
 #include "lrucache.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 namespace zim
 {
@@ -36,55 +41,115 @@ namespace zim
    with minimal blocking. Concurrent access to the same element is also
    safe, and, in case of a cache miss, will block until that element becomes
    available.
+
+   The cache is split into independent shards (each with its own lock and
+   LRU list) selected by the hash of the key, so that accesses to different
+   keys rarely contend for the same lock. As a consequence, the eviction
+   order is LRU per shard rather than for the whole cache.
  */
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
 class ConcurrentCache
 {
 private: // types
-  typedef std::shared_future<Value> ValuePlaceholder;
-  typedef lru_cache<Key, ValuePlaceholder> Impl;
+  // Entry of the cache. The value is either available or being computed
+  // (by the thread that missed it), in which case it can be waited for
+  // through the placeholder. Once the value is available the placeholder
+  // is released, so that hits don't touch any shared state.
+  struct Slot
+  {
+    bool ready = false;
+    Value value = Value();
+    std::shared_future<Value> placeholder;
+  };
+
+  typedef lru_cache<Key, Slot, Hash> Impl;
+
+  struct alignas(64) Shard
+  {
+    explicit Shard(size_t maxEntries) : impl(maxEntries) {}
+
+    std::mutex lock;
+    Impl impl;
+  };
 
 public: // types
-  explicit ConcurrentCache(size_t maxEntries)
-    : impl_(maxEntries)
-  {}
+  static constexpr size_t DEFAULT_SHARD_COUNT = 16;
+
+  explicit ConcurrentCache(size_t maxEntries, size_t shardCount = DEFAULT_SHARD_COUNT)
+  {
+    shardCount = std::max<size_t>(1, std::min(shardCount, maxEntries));
+    const size_t maxEntriesPerShard = (maxEntries + shardCount - 1) / shardCount;
+    for ( size_t i = 0; i < shardCount; ++i )
+      shards_.emplace_back(new Shard(maxEntriesPerShard));
+  }
 
   // Gets the entry corresponding to the given key. If the entry is not in the
   // cache, it is obtained by calling f() (without any arguments) and the
   // result is put into the cache.
   //
-  // The cache as a whole is locked only for the duration of accessing
-  // the respective slot. If, in the case of the a cache miss, the generation
-  // of the missing element takes a long time, only attempts to access that
-  // element will block - the rest of the cache remains open to concurrent
-  // access.
+  // Only the shard of the key is locked, and only for the duration of
+  // accessing the respective slot. If, in the case of the a cache miss, the
+  // generation of the missing element takes a long time, only attempts to
+  // access that element will block - the rest of the cache remains open to
+  // concurrent access.
   template<class F>
   Value getOrPut(const Key& key, F f)
   {
+    Shard& shard = shardOf(key);
+    std::unique_lock<std::mutex> l(shard.lock);
+    const auto x = shard.impl.get(key);
+    if ( x.hit() ) {
+      const Slot& slot = x.value();
+      if ( slot.ready )
+        return slot.value;
+      const auto placeholder = slot.placeholder;
+      l.unlock();
+      return placeholder.get();
+    }
+
     std::promise<Value> valuePromise;
-    std::unique_lock<std::mutex> l(lock_);
-    const auto x = impl_.getOrPut(key, valuePromise.get_future().share());
+    Slot pending;
+    pending.placeholder = valuePromise.get_future().share();
+    shard.impl.put(key, pending);
     l.unlock();
-    if ( x.miss() ) {
-      try {
-        valuePromise.set_value(f());
-      } catch (std::exception& e) {
-        l.lock();
-        impl_.drop(key);
-        l.unlock();
-        throw;
-      }
+
+    Slot computed;
+    try {
+      computed.value = f();
+    } catch (...) {
+      // Whatever is thrown, the threads waiting for the value get it too
+      l.lock();
+      shard.impl.drop(key);
+      l.unlock();
+      valuePromise.set_exception(std::current_exception());
+      throw;
     }
+    computed.ready = true;
+    valuePromise.set_value(computed.value);
 
-    return x.value().get();
+    l.lock();
+    if ( shard.impl.exists(key) )
+      shard.impl.put(key, computed);
+    return computed.value;
+  }
+
+private: // functions
+  Shard& shardOf(const Key& key)
+  {
+    // The bits of the hash are mixed so that the selection of the shard
+    // is independent from the slot of the key in the shard's hash table.
+    uint64_t h = hash_(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return *shards_[h % shards_.size()];
   }
 
 private: // data
-  Impl impl_;
-  std::mutex lock_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  Hash hash_;
 };
 
 } // namespace zim
 
 #endif // ZIM_CONCURRENT_CACHE_H
-
@@ -36,20 +36,26 @@
 #ifndef _LRUCACHE_HPP_INCLUDED_
 #define _LRUCACHE_HPP_INCLUDED_
 
-#include <map>
-#include <list>
+#include <vector>
+#include <algorithm>
+#include <functional>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <stdexcept>
 #include <cassert>
 
 namespace zim {
 
-template<typename key_t, typename value_t>
+// LRU cache stored in flat arrays.
+//
+// The entries live in a vector of nodes, linked into the LRU list by node
+// indices. They are found through an open addressing hash table (with
+// linear probing and backward shift deletion) of node indices. Apart from
+// the growth of those two arrays, no memory is allocated by the cache.
+template<typename key_t, typename value_t, typename hash_t = std::hash<key_t>>
 class lru_cache {
 public: // types
-  typedef typename std::pair<key_t, value_t> key_value_pair_t;
-  typedef typename std::list<key_value_pair_t>::iterator list_iterator_t;
-
   enum AccessStatus {
     HIT, // key was found in the cache
     PUT, // key was not in the cache but was created by the getOrPut() access
@@ -80,77 +86,212 @@ public: // types
 
 public: // functions
   explicit lru_cache(size_t max_size) :
-    _max_size(max_size) {
+    _table(16, EMPTY),
+    _max_size(std::min<size_t>(max_size, NIL - 1)) {
   }
 
   // If 'key' is present in the cache, returns the associated value,
   // otherwise puts the given value into the cache (and returns it with
   // a status of a cache miss).
   AccessResult getOrPut(const key_t& key, const value_t& value) {
-    auto it = _cache_items_map.find(key);
-    if (it != _cache_items_map.end()) {
-      _cache_items_list.splice(_cache_items_list.begin(), _cache_items_list, it->second);
-      return AccessResult(it->second->second, HIT);
+    const size_t hash = _hasher(key);
+    const size_t slot = findSlot(key, hash);
+    if (_table[slot] != EMPTY) {
+      const index_t i = _table[slot] - 1;
+      moveToFront(i);
+      return AccessResult(_nodes[i].value, HIT);
     } else {
-      putMissing(key, value);
+      putMissing(key, value, hash);
       return AccessResult(value, PUT);
     }
   }
 
   void put(const key_t& key, const value_t& value) {
-    auto it = _cache_items_map.find(key);
-    if (it != _cache_items_map.end()) {
-      _cache_items_list.splice(_cache_items_list.begin(), _cache_items_list, it->second);
-      it->second->second = value;
+    const size_t hash = _hasher(key);
+    const size_t slot = findSlot(key, hash);
+    if (_table[slot] != EMPTY) {
+      const index_t i = _table[slot] - 1;
+      moveToFront(i);
+      _nodes[i].value = value;
     } else {
-      putMissing(key, value);
+      putMissing(key, value, hash);
     }
   }
 
   AccessResult get(const key_t& key) {
-    auto it = _cache_items_map.find(key);
-    if (it == _cache_items_map.end()) {
+    const size_t slot = findSlot(key, _hasher(key));
+    if (_table[slot] == EMPTY) {
       return AccessResult();
     } else {
-      _cache_items_list.splice(_cache_items_list.begin(), _cache_items_list, it->second);
-      return AccessResult(it->second->second, HIT);
+      const index_t i = _table[slot] - 1;
+      moveToFront(i);
+      return AccessResult(_nodes[i].value, HIT);
     }
   }
 
   bool drop(const key_t& key) {
-    try {
-      auto list_it = _cache_items_map.at(key);
-      _cache_items_list.erase(list_it);
-      _cache_items_map.erase(key);
-      return true;
-    } catch (std::out_of_range& e) {
+    const size_t slot = findSlot(key, _hasher(key));
+    if (_table[slot] == EMPTY)
       return false;
-    }
+
+    const index_t i = _table[slot] - 1;
+    eraseSlot(slot);
+    unlink(i);
+    _nodes[i].key = key_t();
+    _nodes[i].value = value_t();
+    _free_nodes.push_back(i);
+    --_size;
+    return true;
   }
 
   bool exists(const key_t& key) const {
-    return _cache_items_map.find(key) != _cache_items_map.end();
+    return _table[findSlot(key, _hasher(key))] != EMPTY;
   }
 
   size_t size() const {
-    return _cache_items_map.size();
+    return _size;
   }
 
+private: // types
+  typedef uint32_t index_t;
+
+  static constexpr index_t NIL = std::numeric_limits<index_t>::max();
+
+  // Value of an empty slot of the hash table (slots store node index + 1)
+  static constexpr index_t EMPTY = 0;
+
+  struct Node
+  {
+    key_t key;
+    value_t value;
+    size_t hash;
+    index_t prev; // towards the most recently used entry
+    index_t next; // towards the least recently used entry
+  };
+
 private: // functions
-  void putMissing(const key_t& key, const value_t& value) {
-    assert(_cache_items_map.find(key) == _cache_items_map.end());
-    _cache_items_list.push_front(key_value_pair_t(key, value));
-    _cache_items_map[key] = _cache_items_list.begin();
-    if (_cache_items_map.size() > _max_size) {
-      _cache_items_map.erase(_cache_items_list.back().first);
-      _cache_items_list.pop_back();
+  size_t mask() const { return _table.size() - 1; }
+
+  // Returns the slot of the hash table holding the key or, if the key is
+  // not in the cache, the empty slot where it would be inserted.
+  size_t findSlot(const key_t& key, size_t hash) const {
+    for (size_t slot = hash & mask(); ; slot = (slot + 1) & mask()) {
+      const index_t t = _table[slot];
+      if (t == EMPTY)
+        return slot;
+      const Node& node = _nodes[t - 1];
+      if (node.hash == hash && node.key == key)
+        return slot;
+    }
+  }
+
+  void putMissing(const key_t& key, const value_t& value, size_t hash) {
+    if (_max_size == 0)
+      return;
+
+    if (_size == _max_size) {
+      // Evict the least recently used entry
+      const index_t lru = _tail;
+      eraseSlot(findSlot(_nodes[lru].key, _nodes[lru].hash));
+      unlink(lru);
+      _free_nodes.push_back(lru);
+      --_size;
+    }
+
+    if (2 * (_size + 1) > _table.size())
+      growTable();
+
+    index_t i;
+    if (!_free_nodes.empty()) {
+      i = _free_nodes.back();
+      _free_nodes.pop_back();
+      _nodes[i].key = key;
+      _nodes[i].value = value;
+      _nodes[i].hash = hash;
+    } else {
+      i = index_t(_nodes.size());
+      _nodes.push_back(Node{key, value, hash, NIL, NIL});
+    }
+    linkFront(i);
+    _table[findSlot(key, hash)] = i + 1;
+    ++_size;
+  }
+
+  void growTable() {
+    std::vector<index_t> oldTable(2 * _table.size(), EMPTY);
+    oldTable.swap(_table);
+    for (const index_t t : oldTable) {
+      if (t != EMPTY) {
+        size_t slot = _nodes[t - 1].hash & mask();
+        while (_table[slot] != EMPTY)
+          slot = (slot + 1) & mask();
+        _table[slot] = t;
+      }
+    }
+  }
+
+  // Empties a slot of the hash table, moving back the following entries
+  // of the probe sequence so that no tombstone is needed.
+  void eraseSlot(size_t hole) {
+    size_t slot = hole;
+    for (;;) {
+      slot = (slot + 1) & mask();
+      const index_t t = _table[slot];
+      if (t == EMPTY)
+        break;
+      const size_t home = _nodes[t - 1].hash & mask();
+      // The entry can fill the hole unless its home slot is cyclically
+      // in (hole, slot]
+      const bool homeInRange = hole <= slot
+                             ? (hole < home && home <= slot)
+                             : (hole < home || home <= slot);
+      if (!homeInRange) {
+        _table[hole] = t;
+        hole = slot;
+      }
+    }
+    _table[hole] = EMPTY;
+  }
+
+  void unlink(index_t i) {
+    Node& node = _nodes[i];
+    if (node.prev != NIL)
+      _nodes[node.prev].next = node.next;
+    else
+      _head = node.next;
+    if (node.next != NIL)
+      _nodes[node.next].prev = node.prev;
+    else
+      _tail = node.prev;
+  }
+
+  void linkFront(index_t i) {
+    Node& node = _nodes[i];
+    node.prev = NIL;
+    node.next = _head;
+    if (_head != NIL)
+      _nodes[_head].prev = i;
+    _head = i;
+    if (_tail == NIL)
+      _tail = i;
+  }
+
+  void moveToFront(index_t i) {
+    if (_head != i) {
+      unlink(i);
+      linkFront(i);
     }
   }
 
 private: // data
-  std::list<key_value_pair_t> _cache_items_list;
-  std::map<key_t, list_iterator_t> _cache_items_map;
+  std::vector<Node> _nodes;
+  std::vector<index_t> _free_nodes;
+  std::vector<index_t> _table;
+  index_t _head = NIL;
+  index_t _tail = NIL;
+  size_t _size = 0;
   size_t _max_size;
+  hash_t _hasher;
 };
 
 } // namespace zim
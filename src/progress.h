@@ -21,65 +21,276 @@
 #ifndef _ZIM_TOOL_PROGRESS_H_
 #define _ZIM_TOOL_PROGRESS_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
-#include <atomic>
 #include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
 
-using TimePoint = std::chrono::system_clock::time_point;
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
-class ProgressBar //Class for implementing a progress bar(used in redundancy, url and MIME checks).
+// Progress report of a long-running task processing items, possibly from
+// several threads (used by zimcheck, zimrecreate and zimwriterfs).
+//
+// report() is called once per processed item and only increments a relaxed
+// atomic counter. The counters are sharded over cache lines so that the
+// threads don't contend for the same one. While the task is running, a
+// reporter thread reports the progress every time_interval seconds: the
+// count of processed items (and bytes), their rate and the estimated time
+// left (if the count of items of the task is known). The progress is
+// printed on the standard output and/or written as NDJSON records (a JSON
+// object per line) to a file descriptor.
+class ProgressBar
 {
-private:
-    double time_interval; // The time interval a report will be printed.
-    TimePoint last_report_time; // Last time a report has been printed.
-    int max_no;     //Maximum no of times report() will be called.
-    std::atomic<int> counter;    //Number of times report() has been called(at a particular time).
+private: // types
+    typedef std::chrono::steady_clock Clock;
+
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+
+    static const size_t SHARD_COUNT = 64;
+
+private: // data
+    const std::chrono::duration<double> time_interval; // The time interval a report will be printed.
+    uint64_t max_no;     //Maximum no of times report() will be called.
+    bool known_max;      //Whether max_no is known.
+    std::array<Shard, SHARD_COUNT> shards; //Number of times report() has been called, over all shards.
     bool report_progress; //Boolean value to store wether report should display any characters.
+    int progress_fd;     //File descriptor receiving the NDJSON records (if not -1).
+    std::string name;    //Name of the task in the NDJSON records.
+    std::string phase;   //Phase of the task in the NDJSON records.
+    Clock::time_point start_time;
+
+    std::thread reporter;
     std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
 
 public:
-    ProgressBar(double time_interval)
+    explicit ProgressBar(double time_interval)
       : time_interval(time_interval),
         max_no(0),
-        counter(0),
-        report_progress(false)
+        known_max(true),
+        report_progress(false),
+        progress_fd(-1)
     { }
 
-    void reset(int max_n)
+    ~ProgressBar()
     {
-        max_no = max_n;
-        counter=0;
-        last_report_time=TimePoint();
-        time_interval=1;
+        finish();
+    }
+
+    ProgressBar(const ProgressBar&) = delete;
+    ProgressBar& operator=(const ProgressBar&) = delete;
+
+    // Starts a (phase of the) task processing max_n items
+    void reset(int max_n, const std::string& phase_name = "")
+    {
+        restart(std::max(max_n, 0), true, phase_name);
+    }
+
+    // Starts a (phase of the) task processing an unknown count of items
+    void start(const std::string& phase_name = "")
+    {
+        restart(0, false, phase_name);
     }
 
     void report()
     {
-        if(counter >= max_no)
-            return;
+        shards[shardIndex()].count.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        counter++;
+    // Counts bytes processed along with the items
+    void addBytes(uint64_t bytes)
+    {
+        shards[shardIndex()].bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
 
-        if(!report_progress)
+    // Reports the final progress once all the items are processed
+    void finish()
+    {
+        if (!reporter.joinable())
             return;
-
-        std::unique_lock<std::mutex> lock(mutex);
-        auto now = std::chrono::system_clock::now();
-        std::chrono::duration<double> duration = now-last_report_time;
-        if (duration.count() > time_interval) {
-            std::cout << "\r" << counter << "/" << max_no << std::flush;
-            last_report_time = now;
-        }
-        if(counter == max_no)
         {
-            std::cout << "\r" << counter << "/" << max_no << std::endl;
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
         }
+        cv.notify_all();
+        reporter.join();
+    }
+
+    // Number of times report() has been called since the last reset()
+    uint64_t count() const
+    {
+        uint64_t total = 0;
+        for (const auto& shard : shards)
+            total += shard.count.load(std::memory_order_relaxed);
+        return known_max ? std::min(total, max_no) : total;
+    }
+
+    uint64_t bytes() const
+    {
+        uint64_t total = 0;
+        for (const auto& shard : shards)
+            total += shard.bytes.load(std::memory_order_relaxed);
+        return total;
     }
 
     void set_progress_report(bool report=true) {
         report_progress = report;
     }
+
+    // Writes the progress records of the task called task_name to the file
+    // descriptor fd (-1 disables the records). Every record is written by a
+    // single write() call, so that the records of concurrent tasks sharing
+    // a pipe don't mix.
+    void set_progress_fd(int fd, const std::string& task_name) {
+        progress_fd = fd;
+        name = task_name;
+    }
+
+private:
+    struct Snapshot
+    {
+        uint64_t count;
+        uint64_t bytes;
+        double elapsed;  // seconds
+
+        double rate() const { return elapsed > 0 ? count / elapsed : 0; }
+        double byteRate() const { return elapsed > 0 ? bytes / elapsed : 0; }
+    };
+
+    void restart(uint64_t max_n, bool known, const std::string& phase_name)
+    {
+        finish();
+        for (auto& shard : shards) {
+            shard.count.store(0, std::memory_order_relaxed);
+            shard.bytes.store(0, std::memory_order_relaxed);
+        }
+        max_no = max_n;
+        known_max = known;
+        phase = phase_name;
+        start_time = Clock::now();
+        if ((report_progress || progress_fd != -1) && (max_no > 0 || !known_max)) {
+            stopping = false;
+            reporter = std::thread([this]() { this->run(); });
+        }
+    }
+
+    // Every thread reports into its own shard (shared with other threads
+    // only if there are more threads than shards)
+    static size_t shardIndex()
+    {
+        static std::atomic<size_t> threadCount{0};
+        thread_local const size_t index = threadCount++ % SHARD_COUNT;
+        return index;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait_for(lock, time_interval, [this]() { return stopping; });
+            const std::chrono::duration<double> elapsed = Clock::now() - start_time;
+            const Snapshot snapshot{count(), bytes(), elapsed.count()};
+            const bool done = stopping || (known_max && snapshot.count == max_no);
+            if (report_progress)
+                std::cout << "\r" << line(snapshot) << (done ? "\n" : "") << std::flush;
+            if (progress_fd != -1)
+                writeRecord(record(snapshot, done));
+            if (done)
+                break;
+        }
+    }
+
+    // Estimated seconds left (if the count of items is known)
+    bool eta(const Snapshot& snapshot, uint64_t& seconds) const
+    {
+        if (!known_max || snapshot.rate() <= 0)
+            return false;
+        seconds = (max_no - snapshot.count) / snapshot.rate();
+        return true;
+    }
+
+    std::string line(const Snapshot& snapshot) const
+    {
+        std::ostringstream ss;
+        ss << snapshot.count;
+        if (known_max)
+            ss << "/" << max_no;
+        ss << " (" << uint64_t(snapshot.rate()) << "/s";
+        if (snapshot.bytes > 0)
+            ss << ", " << std::fixed << std::setprecision(1)
+               << snapshot.byteRate() / (1024 * 1024) << " MB/s";
+        uint64_t seconds;
+        if (snapshot.count < max_no && eta(snapshot, seconds)) {
+            ss << ", ETA " << seconds / 3600 << ":" << std::setfill('0')
+               << std::setw(2) << seconds / 60 % 60 << ":" << std::setw(2) << seconds % 60;
+        }
+        ss << ")";
+        return ss.str();
+    }
+
+    std::string record(const Snapshot& snapshot, bool done) const
+    {
+        std::ostringstream ss;
+        ss << "{\"name\":" << quoted(name);
+        if (!phase.empty())
+            ss << ",\"phase\":" << quoted(phase);
+        ss << ",\"done\":" << snapshot.count;
+        if (known_max)
+            ss << ",\"total\":" << max_no;
+        ss << ",\"bytes\":" << snapshot.bytes
+           << ",\"elapsed_seconds\":" << snapshot.elapsed
+           << ",\"items_per_second\":" << snapshot.rate()
+           << ",\"bytes_per_second\":" << snapshot.byteRate();
+        uint64_t seconds;
+        if (eta(snapshot, seconds))
+            ss << ",\"eta_seconds\":" << seconds;
+        ss << ",\"finished\":" << (done ? "true" : "false") << "}\n";
+        return ss.str();
+    }
+
+    static std::string quoted(const std::string& s)
+    {
+        std::ostringstream ss;
+        ss << '"';
+        for (const unsigned char c : s) {
+            if (c == '"' || c == '\\')
+                ss << '\\' << c;
+            else if (c < 0x20)
+                ss << "\\u" << std::hex << std::setfill('0') << std::setw(4) << int(c) << std::dec;
+            else
+                ss << c;
+        }
+        ss << '"';
+        return ss.str();
+    }
+
+    void writeRecord(const std::string& r) const
+    {
+        // Errors are ignored: the progress records are only informative
+#ifdef _WIN32
+        const auto written = _write(progress_fd, r.data(), unsigned(r.size()));
+#else
+        const auto written = ::write(progress_fd, r.data(), r.size());
+#endif
+        (void)written;
+    }
 };
 
 #endif //_ZIM_TOOL_PROGRESS_H_
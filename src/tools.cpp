@@ -33,6 +33,7 @@
 #include <algorithm>
 #include <regex>
 #include <array>
+#include <iterator>
 
 #ifdef _WIN32
 #define SEPARATOR "\\"
@@ -278,9 +279,9 @@ void stripTitleInvalidChars(std::string& str)
 namespace
 {
 
-const char* getHtmlEntity(const std::string& core)
+const char* getHtmlEntity(std::string_view core)
 {
-  static const std::map<std::string, const char*> t = {
+  static const std::pair<std::string_view, const char*> t[] = {
     { "amp",  "&"  },
     { "apos", "'"  },
     { "quot", "\"" },
@@ -288,18 +289,29 @@ const char* getHtmlEntity(const std::string& core)
     { "gt",   ">"  },
   };
 
-  const auto it = t.find(core);
-  return it != t.end() ? it->second : nullptr;
+  for ( const auto& entity : t ) {
+    if ( entity.first == core )
+      return entity.second;
+  }
+  return nullptr;
 }
 
 } // unnamed namespace
 
 std::string decodeHtmlEntities(const std::string& str)
 {
-  const char* p = str.c_str();
   std::string result;
+  decodeHtmlEntities(std::string_view(str.c_str()), result);
+  return result;
+}
+
+void decodeHtmlEntities(std::string_view str, std::string& result)
+{
+  result.clear();
+  const char* p = str.data();
+  const char* const end = p + str.size();
   const char* start = nullptr;
-  for ( ; *p ; ++p ) {
+  for ( ; p != end ; ++p ) {
     if ( *p == '&' ) {
       if ( start ) {
         result.insert(result.end(), start, p);
@@ -308,7 +320,7 @@ std::string decodeHtmlEntities(const std::string& str)
     } else if ( !start ) {
       result.push_back(*p);
     } else if ( *p == ';' ) {
-      const char* d = getHtmlEntity(std::string(start+1, p));
+      const char* d = getHtmlEntity(std::string_view(start+1, p-start-1));
       if ( d ) {
         result += d;
       } else {
@@ -320,92 +332,262 @@ std::string decodeHtmlEntities(const std::string& str)
   if ( start ) {
     result.insert(result.end(), start, p);
   }
-  return result;
 }
 
-std::vector<html_link> generic_getLinks(const std::string& page)
+namespace
 {
-    const char* p = page.c_str();
-    const char* linkStart;
-    std::vector<html_link> links;
-    std::string attr;
 
-    while (*p) {
-        if (strncmp(p, " href", 5) == 0) {
-            attr = "href";
-            p += 5;
-        } else if (strncmp(p, " src", 4) == 0) {
-            attr = "src";
-            p += 4;
+// Calls f(attribute, link) for every href or src attribute with a quoted
+// value found in the page. `attribute` and `link` are slices of the page
+// (the link is not HTML-decoded).
+//
+// Instead of trying to match the attribute names at every position of the
+// page, the scanner jumps from one '=' to the next one (memchr is vectorized
+// by the C library) and then checks the attribute name backwards.
+template<class F>
+void scanHtmlLinks(std::string_view page, F f)
+{
+    const char* const begin = page.data();
+    const char* const end = begin + page.size();
+    // Start of the part of the page that is not a link value
+    const char* textStart = begin;
+    const char* p = begin;
+
+    while ( p != end ) {
+        const char* const eq = static_cast<const char*>(memchr(p, '=', end - p));
+        if ( !eq )
+            break;
+        p = eq + 1;
+
+        const char* nameEnd = eq;
+        while ( nameEnd != textStart && nameEnd[-1] == ' ' )
+            --nameEnd;
+
+        std::string_view attr;
+        if ( nameEnd - textStart >= 5 && memcmp(nameEnd - 5, " href", 5) == 0 ) {
+            attr = std::string_view(nameEnd - 4, 4);
+        } else if ( nameEnd - textStart >= 4 && memcmp(nameEnd - 4, " src", 4) == 0 ) {
+            attr = std::string_view(nameEnd - 3, 3);
         } else {
-            p += 1;
             continue;
         }
 
-        while (*p == ' ')
-            p += 1 ;
-        if (*(p++) != '=')
-            continue;
-        while (*p == ' ')
-            p += 1;
-        char delimiter = *p++;
-        if (delimiter != '\'' && delimiter != '"')
+        while ( p != end && *p == ' ' )
+            ++p;
+        if ( p == end )
+            break;
+        const char delimiter = *p++;
+        if ( delimiter != '\'' && delimiter != '"' )
             continue;
 
-        linkStart = p;
         // [TODO] Handle escape char
-        while(*p != delimiter)
-            p++;
-        const std::string link(linkStart, p);
-        links.push_back(html_link(attr, decodeHtmlEntities(link)));
-        p += 1;
+        const char* const linkEnd = static_cast<const char*>(memchr(p, delimiter, end - p));
+        if ( !linkEnd )
+            break;
+        f(attr, std::string_view(p, linkEnd - p));
+        p = textStart = linkEnd + 1;
     }
-    return links;
 }
 
-bool isOutofBounds(const std::string& input, std::string base)
+} // unnamed namespace
+
+void HtmlLinkCollection::clear()
+{
+    links.clear();
+    decodedLinkCount = 0;
+}
+
+void HtmlLinkCollection::add(std::string_view attr, std::string_view link)
+{
+    links.push_back(html_link(attr, link));
+}
+
+void HtmlLinkCollection::addHtmlEncoded(std::string_view attr, std::string_view encodedLink)
+{
+    if ( encodedLink.find('&') == std::string_view::npos ) {
+        add(attr, encodedLink);
+        return;
+    }
+
+    // The strings of the previous pages are reused (rather than released)
+    // in order to save on memory allocations. std::deque doesn't move its
+    // elements when growing, so the links pointing to them stay valid.
+    if ( decodedLinkCount == decodedLinks.size() )
+        decodedLinks.emplace_back();
+    std::string& decodedLink = decodedLinks[decodedLinkCount++];
+    decodeHtmlEntities(encodedLink, decodedLink);
+    add(attr, decodedLink);
+}
+
+void generic_getLinks(std::string_view page, HtmlLinkCollection& links)
+{
+    links.clear();
+    scanHtmlLinks(page, [&links](std::string_view attr, std::string_view link) {
+        links.addHtmlEncoded(attr, link);
+    });
+}
+
+bool isOutofBounds(std::string_view input, std::string_view base)
 {
     if (input.empty()) return false;
 
-    if (!base.length() || base.back() != '/')
-        base.push_back('/');
+    // base is considered with a trailing '/'
+    const bool addSlash = base.empty() || base.back() != '/';
 
     int nr = 0;
-    if (base.front() != '/')
+    if (!base.empty() && base.front() != '/')
         nr++;
 
     //count nr of substrings ../
     int nrsteps = 0;
-    std::string::size_type pos = 0;
-    while((pos = input.find("../", pos)) != std::string::npos) {
+    std::string_view::size_type pos = 0;
+    while((pos = input.find("../", pos)) != std::string_view::npos) {
         nrsteps++;
         pos += 3;
     }
 
-    return nrsteps >= (nr + std::count(base.cbegin(), base.cend(), '/'));
+    return nrsteps >= (nr + addSlash + std::count(base.cbegin(), base.cend(), '/'));
 }
 
-int adler32(const std::string& buf)
+namespace
 {
-    unsigned int s1 = 1;
-    unsigned int s2 = 0;
-    unsigned int sz=buf.size();
-    for (size_t n = 0; n <sz; n++)
-    {
-        s1 = (s1 + buf[n]) % 65521;
-        s2 = (s2 + s1) % 65521;
+
+const uint32_t ADLER_BASE = 65521;
+
+// Largest n such that 255n(n+1)/2 + (n+1)(ADLER_BASE-1) <= 2^32-1, i.e. the
+// count of bytes that can be processed before the sums have to be reduced
+// modulo ADLER_BASE.
+const size_t ADLER_NMAX = 5552;
+
+void updateAdler32(const unsigned char* p, size_t size, uint32_t& s1, uint32_t& s2)
+{
+    while ( size > 0 ) {
+        const size_t n = std::min(size, ADLER_NMAX);
+        size -= n;
+        for ( const unsigned char* end = p + n; p != end; ++p ) {
+            s1 += *p;
+            s2 += s1;
+        }
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
     }
+}
+
+} // unnamed namespace
+
+int adler32(const char* data, size_t size)
+{
+    uint32_t s1 = 1;
+    uint32_t s2 = 0;
+    updateAdler32(reinterpret_cast<const unsigned char*>(data), size, s1, s2);
     return (s2 << 16) | s1;
 }
 
+int adler32(const std::string& buf)
+{
+    return adler32(buf.data(), buf.size());
+}
+
+namespace
+{
+
+inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+inline uint64_t readLE64(const unsigned char* p)
+{
+    uint64_t v = 0;
+    for ( int i = 7; i >= 0; --i )
+        v = (v << 8) | p[i];
+    return v;
+}
+
+} // unnamed namespace
+
+Hash128 hash128(const char* data, size_t size)
+{
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    const auto bytes = reinterpret_cast<const unsigned char*>(data);
+    const size_t nblocks = size / 16;
+
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+
+    for ( size_t i = 0; i < nblocks; ++i ) {
+        uint64_t k1 = readLE64(bytes + i*16);
+        uint64_t k2 = readLE64(bytes + i*16 + 8);
+
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1*5 + 0x52dce729;
+
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2*5 + 0x38495ab5;
+    }
+
+    const unsigned char* tail = bytes + nblocks*16;
+    const size_t tailSize = size & 15;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    for ( size_t i = tailSize; i > 8; --i )
+        k2 = (k2 << 8) | tail[i-1];
+    for ( size_t i = std::min(tailSize, size_t(8)); i > 0; --i )
+        k1 = (k1 << 8) | tail[i-1];
+    if ( tailSize > 8 ) {
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    if ( tailSize > 0 ) {
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= size;
+    h2 ^= size;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    return Hash128{h1, h2};
+}
+
+Hash128 hash128(const std::string& buf)
+{
+    return hash128(buf.data(), buf.size());
+}
+
 std::string normalize_link(const std::string& input, const std::string& baseUrl)
 {
     std::string output;
+    normalize_link(input, baseUrl, output);
+    return output;
+}
+
+void normalize_link(std::string_view input, std::string_view baseUrl, std::string& output)
+{
+    output.clear();
     output.reserve(baseUrl.size() + input.size() + 1);
 
+    const auto startsWith = [&input](std::string_view::const_iterator p, std::string_view prefix) {
+        return size_t(input.cend() - p) >= prefix.size()
+            && std::equal(prefix.begin(), prefix.end(), p);
+    };
+
     bool check_rel = false;
     auto p = input.cbegin();
-    if ( *(p) == '/') {
+    if ( !input.empty() && *(p) == '/') {
       // This is an absolute url.
       p++;
     } else {
@@ -421,7 +603,7 @@ std::string normalize_link(const std::string& input, const std::string& baseUrl)
     while (p < input.cend())
     {
         if ( check_rel ) {
-            if (std::strncmp(&*p, "../", 3) == 0) {
+            if (startsWith(p, "../")) {
                 // We must go "up"
                 // Remove the '/' at the end of output.
                 output.resize(output.size()-1);
@@ -433,7 +615,7 @@ std::string normalize_link(const std::string& input, const std::string& baseUrl)
                 check_rel = false;
                 continue;
             }
-            if (std::strncmp(&*p, "./", 2) == 0) {
+            if (startsWith(p, "./")) {
                 // We must simply skip this part
                 // Simply move after the ".".
                 p += 2;
@@ -452,13 +634,12 @@ std::string normalize_link(const std::string& input, const std::string& baseUrl)
         {
             if( (p+2) >= input.cend()){
                 // if the %XX token would go off the end of the string, just break
-                // string::end() returns an iterator pointing to the null terminator
-                // of the underlying c-string (guarenteed as of C++11)
                 break;
             }
             // hhx only officially supports hex unsigned char
+            const char hex[3] = { *(p+1), *(p+2), '\0' };
             unsigned char ch = 0;
-            std::sscanf(&*(p+1), "%2hhx", &ch);
+            std::sscanf(hex, "%2hhx", &ch);
             output += ch;
             p += 3;
             continue;
@@ -474,43 +655,131 @@ std::string normalize_link(const std::string& input, const std::string& baseUrl)
         }
         output += *(p++);
     }
-    return output;
 }
 
 namespace
 {
 
-UriKind specialUriSchemeKind(const std::string& s)
+// Case-insensitive comparison of s with the lowercase ASCII string `lower`
+bool equalsIgnoringCase(std::string_view s, std::string_view lower)
 {
-    static const std::map<std::string, UriKind> uriSchemes = {
-        { "javascript", UriKind::JAVASCRIPT },
-        { "mailto",     UriKind::MAILTO     },
-        { "tel",        UriKind::TEL        },
-        { "sip",        UriKind::SIP        },
-        { "geo",        UriKind::GEO        },
-        { "data",       UriKind::DATA       },
-        { "xmpp",       UriKind::XMPP       },
-        { "news",       UriKind::NEWS       },
-        { "urn",        UriKind::URN        }
-    };
+    if ( s.size() != lower.size() )
+        return false;
+    for ( size_t i = 0; i < s.size(); ++i ) {
+        const char c = s[i];
+        if ( (('A' <= c && c <= 'Z') ? c - ('Z' - 'z') : c) != lower[i] )
+            return false;
+    }
+    return true;
+}
 
-    const auto it = uriSchemes.find(s);
-    return it != uriSchemes.end() ? it->second : UriKind::OTHER;
+// The special URI schemes (without authority) that are valid in HTML
+struct SpecialUriScheme
+{
+    std::string_view name; // in lowercase
+    UriKind kind;
+};
+
+constexpr SpecialUriScheme specialUriSchemes[] = {
+    { "javascript", UriKind::JAVASCRIPT },
+    { "mailto",     UriKind::MAILTO },
+    { "tel",        UriKind::TEL },
+    { "sip",        UriKind::SIP },
+    { "geo",        UriKind::GEO },
+    { "data",       UriKind::DATA },
+    { "xmpp",       UriKind::XMPP },
+    { "news",       UriKind::NEWS },
+    { "urn",        UriKind::URN }
+};
+
+const size_t SPECIAL_URI_SCHEME_COUNT = std::size(specialUriSchemes);
+const size_t MAX_SPECIAL_URI_SCHEME_SIZE = 10;
+
+// The special schemes are told apart by their size and first letter, so
+// that at most one full comparison is performed
+constexpr bool specialUriSchemesAreDistinct()
+{
+    for ( size_t i = 0; i < SPECIAL_URI_SCHEME_COUNT; ++i ) {
+        const auto a = specialUriSchemes[i].name;
+        if ( a.empty() || a.size() > MAX_SPECIAL_URI_SCHEME_SIZE || a[0] < 'a' || a[0] > 'z' )
+            return false;
+        for ( size_t j = 0; j < i; ++j ) {
+            const auto b = specialUriSchemes[j].name;
+            if ( a.size() == b.size() && a[0] == b[0] )
+                return false;
+        }
+    }
+    return true;
 }
 
-void asciitolower(std::string& s)
+static_assert(specialUriSchemesAreDistinct(), "Ambiguous special URI schemes");
+
+// 1 + index in specialUriSchemes of the scheme of a given size and first
+// letter, 0 if there is none
+typedef std::array<std::array<uint8_t, 26>, MAX_SPECIAL_URI_SCHEME_SIZE + 1> SpecialUriSchemeTable;
+
+constexpr SpecialUriSchemeTable makeSpecialUriSchemeTable()
 {
-    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){
-        return ('A' <= c && c <= 'Z') ? c - ('Z' - 'z') : c;
-    });
+    SpecialUriSchemeTable table{};
+    for ( size_t i = 0; i < SPECIAL_URI_SCHEME_COUNT; ++i ) {
+        const auto name = specialUriSchemes[i].name;
+        table[name.size()][name[0] - 'a'] = i + 1;
+    }
+    return table;
+}
+
+constexpr SpecialUriSchemeTable specialUriSchemeTable = makeSpecialUriSchemeTable();
+
+UriKind specialUriSchemeKind(std::string_view s)
+{
+    if ( s.empty() || s.size() > MAX_SPECIAL_URI_SCHEME_SIZE )
+        return UriKind::OTHER;
+
+    const char c = s[0] | 0x20; // ASCII lowercase
+    if ( c < 'a' || c > 'z' )
+        return UriKind::OTHER;
+
+    const auto i = specialUriSchemeTable[s.size()][c - 'a'];
+    if ( i == 0 || !equalsIgnoringCase(s, specialUriSchemes[i - 1].name) )
+        return UriKind::OTHER;
+    return specialUriSchemes[i - 1].kind;
+}
+
+// Classes of the characters of a link
+enum : uint8_t
+{
+    URI_DELIMITER = 1,  // ends the scheme of a URI (if it is a ':')
+    PAGE_LOCAL    = 2   // starts a link within the page itself
+};
+
+typedef std::array<uint8_t, 256> UriCharClassTable;
+
+constexpr UriCharClassTable makeUriCharClassTable()
+{
+    UriCharClassTable table{};
+    table[':'] = URI_DELIMITER;
+    table['/'] = URI_DELIMITER;
+    table['?'] = URI_DELIMITER | PAGE_LOCAL;
+    table['#'] = URI_DELIMITER | PAGE_LOCAL;
+    return table;
+}
+
+constexpr UriCharClassTable uriCharClassTable = makeUriCharClassTable();
+
+uint8_t uriCharClass(char c)
+{
+    return uriCharClassTable[uint8_t(c)];
 }
 
 } // unnamed namespace
 
-UriKind html_link::detectUriKind(const std::string& input_string)
+UriKind html_link::detectUriKind(std::string_view input_string)
 {
-    const auto k = input_string.find_first_of(":/?#");
-    if ( k == std::string::npos || input_string[k] != ':' ) {
+    size_t k = 0;
+    while ( k < input_string.size() && !(uriCharClass(input_string[k]) & URI_DELIMITER) )
+        ++k;
+
+    if ( k == input_string.size() || input_string[k] != ':' ) {
         if ( k == 0 && input_string.substr(0, 2) == "//" )
             return UriKind::PROTOCOL_RELATIVE;
         else
@@ -522,9 +791,25 @@ UriKind html_link::detectUriKind(const std::string& input_string)
          && input_string[k+2] == '/' )
         return UriKind::GENERIC_URI;
 
-    std::string scheme = input_string.substr(0, k);
-    asciitolower(scheme);
-    return specialUriSchemeKind(scheme);
+    return specialUriSchemeKind(input_string.substr(0, k));
+}
+
+LinkClass html_link::classify(std::string_view baseUrl) const
+{
+    if ( link.empty() )
+        return LinkClass::EMPTY;
+
+    if ( uriCharClass(link.front()) & PAGE_LOCAL )
+        return LinkClass::FRAGMENT;
+
+    switch ( detectUriKind(link) ) {
+    case UriKind::OTHER:
+        return isOutofBounds(link, baseUrl) ? LinkClass::OUT_OF_BOUNDS : LinkClass::INTERNAL;
+    case UriKind::DATA:
+        return LinkClass::DATA;
+    default:
+        return attribute == "src" ? LinkClass::EXTERNAL_RESOURCE : LinkClass::EXTERNAL;
+    }
 }
 
 namespace
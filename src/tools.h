@@ -21,8 +21,11 @@
 #ifndef OPENZIM_TOOLS_H
 #define OPENZIM_TOOLS_H
 
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 #include <sstream>
@@ -78,30 +81,68 @@ enum class UriKind : int
                     // or absolute URL)
 };
 
+// What a link found in an HTML page is, as far as the checks of the links
+// are concerned (see html_link::classify())
+enum class LinkClass : int
+{
+    EMPTY,
+    FRAGMENT,           // #fragment or ?query, within the page itself
+    INTERNAL,           // relative or absolute URL of an entry
+    OUT_OF_BOUNDS,      // relative URL going above the root of the entries
+    EXTERNAL,           // URI with a scheme or protocol-relative URL
+    EXTERNAL_RESOURCE,  // external link of a resource (src attribute)
+    DATA                // data URI
+};
+
+// A link found in an HTML page. It doesn't own the attribute and link
+// strings (see HtmlLinkCollection).
 class html_link
 {
 public:
-    const std::string attribute;
-    const std::string link;
-    const UriKind     uriKind;
+    const std::string_view attribute;
+    const std::string_view link;
 
-    html_link(const std::string& _attr, const std::string& _link)
+    html_link(std::string_view _attr, std::string_view _link)
         : attribute(_attr)
         , link(_link)
-        , uriKind(detectUriKind(_link))
     {}
 
-    bool isExternalUrl() const
-    {
-        return uriKind != UriKind::OTHER && uriKind != UriKind::DATA;
-    }
+    // Classifies the link of a page whose path is in the directory baseUrl,
+    // in a single pass over the link
+    LinkClass classify(std::string_view baseUrl) const;
 
-    bool isInternalUrl() const
-    {
-        return uriKind == UriKind::OTHER;
-    }
+    static UriKind detectUriKind(std::string_view input_string);
+};
+
+// The links found in an HTML page.
+//
+// The links point into the page or, for the links that had to be
+// HTML-decoded, into the storage of the collection. Therefore the page must
+// outlive the collection. A collection can be reused for several pages so
+// that its memory is recycled.
+class HtmlLinkCollection
+{
+public:
+    typedef std::vector<html_link>::const_iterator const_iterator;
+
+    HtmlLinkCollection() {}
+    HtmlLinkCollection(const HtmlLinkCollection&) = delete;
+    HtmlLinkCollection& operator=(const HtmlLinkCollection&) = delete;
+
+    void clear();
+    void add(std::string_view attr, std::string_view link);
+    void addHtmlEncoded(std::string_view attr, std::string_view encodedLink);
 
-    static UriKind detectUriKind(const std::string& input_string);
+    const_iterator begin() const { return links.begin(); }
+    const_iterator end() const { return links.end(); }
+    size_t size() const { return links.size(); }
+    bool empty() const { return links.empty(); }
+    const html_link& operator[](size_t i) const { return links[i]; }
+
+private:
+    std::vector<html_link> links;
+    std::deque<std::string> decodedLinks;
+    size_t decodedLinkCount = 0;
 };
 
 // Few helper class to help copy a item from a archive to another one.
@@ -191,21 +232,49 @@ void replaceStringInPlace(std::string& subject,
                           const std::string& replace);
 void stripTitleInvalidChars(std::string& str);
 
-//Returns a vector of the links in a particular page. includes links under 'href' and 'src'
-std::vector<html_link> generic_getLinks(const std::string& page);
+//Fills `links` with the links in a particular page. includes links under 'href' and 'src'
+void generic_getLinks(std::string_view page, HtmlLinkCollection& links);
 
 // checks if a relative path is out of bounds (relative to base)
-bool isOutofBounds(const std::string& input, std::string base);
+bool isOutofBounds(std::string_view input, std::string_view base);
 
-//Adler32 Hash Function. Used to hash the BLOB data obtained from each article, for redundancy checks.
-//Please note that the adler32 hash function has a high number of collisions, and that the hash match is not taken as final.
+//Adler32 Hash Function.
+//Please note that the adler32 hash function has a high number of collisions, and that the hash match cannot be taken as final.
+int adler32(const char* data, size_t size);
 int adler32(const std::string& buf);
 
+// 128-bit content fingerprint (MurmurHash3 x64_128 with a zero seed).
+// Collisions are unlikely enough for two items with the same size and
+// fingerprint to be considered identical.
+struct Hash128
+{
+    uint64_t low;
+    uint64_t high;
+
+    bool operator==(const Hash128& other) const
+    {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+
+    bool operator<(const Hash128& other) const
+    {
+        return high < other.high || (high == other.high && low < other.low);
+    }
+};
+
+Hash128 hash128(const char* data, size_t size);
+Hash128 hash128(const std::string& buf);
+
 std::string decodeHtmlEntities(const std::string& str);
+void decodeHtmlEntities(std::string_view str, std::string& result);
 
 //Removes extra spaces from URLs. Usually done by the browser, so web authors sometimes tend to ignore it.
 //Converts the %20 to space.Essential for comparing URLs.
 std::string normalize_link(const std::string& input, const std::string& baseUrl);
+// Same as above, but writes into `output` (allowing to reuse its buffer)
+void normalize_link(std::string_view input, std::string_view baseUrl, std::string& output);
 
 std::string httpRedirectHtml(const std::string& redirectUrl);
 #endif  // OPENZIM_TOOLS_H
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "check_scheduler.h"
+#include "checks.h"
+
+#include <cassert>
+#include <exception>
+
+namespace
+{
+
+// Result of a check, failed if the check has thrown an exception
+bool getResult(const std::shared_future<bool>& result)
+{
+    try {
+        return result.get();
+    } catch (...) {
+        return false;
+    }
+}
+
+} // unnamed namespace
+
+CheckScheduler::CheckScheduler(ErrorLogger& _reporter)
+    : reporter(_reporter)
+{
+}
+
+CheckScheduler::~CheckScheduler()
+{
+    joinThreads();
+}
+
+CheckScheduler::CheckId CheckScheduler::add(Check check,
+                                            std::vector<CheckId> dependencies,
+                                            std::vector<CheckId> guards)
+{
+    const CheckId id = tasks.size();
+    for ( const auto d : dependencies )
+        assert(d < id);
+    for ( const auto g : guards )
+        assert(g < id);
+
+    std::unique_ptr<Task> task(new Task);
+    task->check = std::move(check);
+    task->dependencies = std::move(dependencies);
+    task->guards = std::move(guards);
+    task->reporter = reporter.makeDeferred();
+    task->result = task->promise.get_future().share();
+    tasks.push_back(std::move(task));
+    return id;
+}
+
+void CheckScheduler::runTask(CheckId id)
+{
+    Task& task = *tasks[id];
+    for ( const auto d : task.dependencies ) {
+        if ( !getResult(tasks[d]->result) ) {
+            task.promise.set_value(false);
+            return;
+        }
+    }
+
+    if ( task.cancelled ) {
+        task.promise.set_value(false);
+        return;
+    }
+
+    bool result = false;
+    try {
+        result = task.check(*task.reporter);
+        task.promise.set_value(result);
+    } catch (...) {
+        task.promise.set_exception(std::current_exception());
+    }
+    if ( !result )
+        cancelGuardedChecks(id);
+}
+
+// The checks are added after their dependencies and guards, so a single
+// pass over the following checks cancels all those affected
+void CheckScheduler::cancelGuardedChecks(CheckId failedGuard)
+{
+    const auto affected = [this, failedGuard](const std::vector<CheckId>& ids) {
+        for ( const auto i : ids ) {
+            if ( i == failedGuard || tasks[i]->cancelled )
+                return true;
+        }
+        return false;
+    };
+
+    for ( CheckId id = failedGuard + 1; id < tasks.size(); ++id ) {
+        Task& task = *tasks[id];
+        if ( affected(task.guards) || affected(task.dependencies) )
+            task.cancelled = true;
+    }
+}
+
+void CheckScheduler::run()
+{
+    for ( CheckId id = 0; id < tasks.size(); ++id ) {
+        threads.emplace_back([this, id]() { this->runTask(id); });
+    }
+
+    std::exception_ptr error;
+    for ( auto& task : tasks ) {
+        task->kept = true;
+        for ( const auto g : task->guards )
+            task->kept = task->kept && tasks[g]->passed;
+        for ( const auto d : task->dependencies )
+            task->kept = task->kept && tasks[d]->kept;
+
+        // From now on, the messages of the check are output as soon as
+        // they are produced
+        if ( task->kept )
+            reporter.mergeDeferred(*task->reporter);
+
+        try {
+            task->passed = task->result.get() && task->kept;
+        } catch (...) {
+            if ( task->kept ) {
+                error = std::current_exception();
+                break;
+            }
+        }
+    }
+
+    joinThreads();
+    if ( error )
+        std::rethrow_exception(error);
+}
+
+bool CheckScheduler::passed(CheckId id) const
+{
+    return tasks[id]->passed;
+}
+
+const std::atomic<bool>& CheckScheduler::cancellation(CheckId id) const
+{
+    return tasks[id]->cancelled;
+}
+
+void CheckScheduler::joinThreads()
+{
+    for ( auto& t : threads ) {
+        if ( t.joinable() )
+            t.join();
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_CHECK_SCHEDULER_H_
+#define _ZIM_TOOL_CHECK_SCHEDULER_H_
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class ErrorLogger;
+
+// Runs the checks of a ZIM file concurrently, as allowed by the dependencies
+// declared between them.
+//
+// A check starts once all its dependencies have passed, and is skipped if any
+// of them fails. A check may also be guarded by other checks: it runs
+// concurrently with them, but its results are discarded if any of them fails
+// (as are the results of the checks depending on it). This allows to read the
+// content of a ZIM file while the validation of the whole file (e.g. of its
+// checksum) is in progress. Once a guard fails, the checks whose results
+// are to be discarded are cancelled: those not started yet are skipped, and
+// those in progress can watch their cancellation flag in order to stop early.
+//
+// Every check reports into its own deferred ErrorLogger. The reports are
+// passed to the main ErrorLogger in the order in which the checks were added,
+// so that the output doesn't depend on the timing of the checks: the messages
+// of a check are held only until all the preceding checks are complete.
+class CheckScheduler
+{
+public: // types
+    typedef size_t CheckId;
+
+    // A check returns false if the checks depending on it must not be run
+    typedef std::function<bool(ErrorLogger& reporter)> Check;
+
+public: // functions
+    explicit CheckScheduler(ErrorLogger& reporter);
+    ~CheckScheduler();
+
+    CheckScheduler(const CheckScheduler&) = delete;
+    CheckScheduler& operator=(const CheckScheduler&) = delete;
+
+    // Dependencies and guards must have been added before the check
+    CheckId add(Check check,
+                std::vector<CheckId> dependencies = {},
+                std::vector<CheckId> guards = {});
+
+    // Runs all the checks and merges their reports. If a check throws an
+    // exception, the reports of the checks following it are dropped and the
+    // exception is rethrown once all the checks are over.
+    void run();
+
+    // Whether the check has run and passed, and its results were kept.
+    // Valid after run().
+    bool passed(CheckId id) const;
+
+    // Set (by any thread) once the results of the check are known to be
+    // discarded: one of its guards has failed or is cancelled, or one of
+    // the checks that it depends on
+    const std::atomic<bool>& cancellation(CheckId id) const;
+
+private: // types
+    struct Task
+    {
+        Check check;
+        std::vector<CheckId> dependencies;
+        std::vector<CheckId> guards;
+        std::unique_ptr<ErrorLogger> reporter;
+        std::promise<bool> promise;
+        std::shared_future<bool> result;
+        std::atomic<bool> cancelled{false};
+
+        // Set by run()
+        bool passed = false;
+        bool kept = false;
+    };
+
+private: // functions
+    void runTask(CheckId id);
+    void cancelGuardedChecks(CheckId failedGuard);
+    void joinThreads();
+
+private: // data
+    ErrorLogger& reporter;
+    std::vector<std::unique_ptr<Task>> tasks;
+    std::vector<std::thread> threads;
+};
+
+#endif // _ZIM_TOOL_CHECK_SCHEDULER_H_
@@ -1,6 +1,14 @@
 #define ZIM_PRIVATE
 #include "checks.h"
+#include "cluster_cache.h"
+#include "external_sort.h"
+#include "link_graph.h"
+#include "link_table.h"
+#include "md5.h"
+#include "path_index.h"
+#include "worker_pool.h"
 #include "../tools.h"
+#include "../cluster_pipeline.h"
 #include "../concurrent_cache.h"
 #include "../metadata.h"
 
@@ -9,11 +17,17 @@
 #include <unordered_map>
 #include <list>
 #include <sstream>
+#include <fstream>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
-#include <thread>
-#include <queue>
+#include <deque>
+#include <exception>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <random>
 #include <zim/archive.h>
 #include <zim/item.h>
 
@@ -39,27 +53,150 @@ std::unordered_map<TestType, std::pair<LogTag, std::string>> errormapping = {
     { TestType::REDIRECT,      {LogTag::ERROR, "Redirect loop(s) exist"}},
 };
 
+// A message template compiled into a sequence of segments: literal text and
+// slots receiving the values of the parameters of the message. The supported
+// syntax is a subset of mustache: {{&param}} and, for the list parameter,
+// {{#list}}...{{&value}}...{{/list}} repeated for every element of the list.
+class MsgTemplate
+{
+public: // functions
+  MsgTemplate(const std::string& tmpl, const std::vector<std::string>& names)
+    : paramNames(names)
+    , hasList(!names.empty() && tmpl.find("{{#" + names.back() + "}}") != std::string::npos)
+  {
+    size_t pos = 0;
+    segments = parse(tmpl, pos, "");
+  }
+
+  // Number of values of the parameters (the list excluded)
+  size_t valueCount() const { return paramNames.size() - hasList; }
+
+  void render(std::string& result, const MsgParams& params) const
+  {
+    render(result, segments, params, nullptr);
+  }
+
+private: // types
+  struct Segment
+  {
+    enum Kind { TEXT, VALUE, LIST, LIST_ELEMENT };
+
+    Kind kind;
+    std::string text;           // TEXT
+    size_t valueIndex = 0;      // VALUE
+    std::vector<Segment> body;  // LIST
+  };
+
+  typedef std::vector<Segment> Segments;
+
+private: // functions
+  Segments parse(const std::string& tmpl, size_t& pos, const std::string& listName)
+  {
+    Segments result;
+    while ( pos < tmpl.size() ) {
+      const size_t tagStart = tmpl.find("{{", pos);
+      if ( tagStart != pos ) {
+        result.push_back({Segment::TEXT, tmpl.substr(pos, tagStart - pos)});
+        if ( tagStart == std::string::npos )
+          break;
+      }
+      const size_t tagEnd = tmpl.find("}}", tagStart);
+      if ( tagEnd == std::string::npos || tagEnd == tagStart + 2 )
+        throw std::logic_error("Invalid message template: " + tmpl);
+      const char tagType = tmpl[tagStart + 2];
+      const std::string name = tmpl.substr(tagStart + 3, tagEnd - tagStart - 3);
+      pos = tagEnd + 2;
+
+      if ( tagType == '&' && !listName.empty() && name == "value" ) {
+        result.push_back({Segment::LIST_ELEMENT});
+      } else if ( tagType == '&' ) {
+        result.push_back({Segment::VALUE, "", paramIndex(tmpl, name)});
+      } else if ( tagType == '#' && listName.empty() && isListParam(name) ) {
+        result.push_back({Segment::LIST, "", 0, parse(tmpl, pos, name)});
+      } else if ( tagType == '/' && name == listName ) {
+        return result;
+      } else {
+        throw std::logic_error("Unsupported tag in message template: " + tmpl);
+      }
+    }
+    if ( !listName.empty() )
+      throw std::logic_error("Unterminated section in message template: " + tmpl);
+    return result;
+  }
+
+  size_t paramIndex(const std::string& tmpl, const std::string& name) const
+  {
+    const auto it = std::find(paramNames.begin(), paramNames.end(), name);
+    if ( it == paramNames.end() || isListParam(name) )
+      throw std::logic_error("Unknown parameter in message template: " + tmpl);
+    return it - paramNames.begin();
+  }
+
+  // Only the last parameter can be a list
+  bool isListParam(const std::string& name) const
+  {
+    return hasList && paramNames.back() == name;
+  }
+
+  static void render(std::string& result, const Segments& segments,
+                     const MsgParams& params, const std::string* element)
+  {
+    for ( const auto& segment : segments ) {
+      switch ( segment.kind ) {
+        case Segment::TEXT:         result += segment.text; break;
+        case Segment::VALUE:        result += params[segment.valueIndex]; break;
+        case Segment::LIST_ELEMENT: result += *element; break;
+        case Segment::LIST:
+          for ( const auto& el : params.list() )
+            render(result, segment.body, params, &el);
+          break;
+      }
+    }
+  }
+
+private: // data
+  const std::vector<std::string> paramNames;
+  const bool hasList;
+  Segments segments;
+};
+
 struct MsgInfo
 {
+  MsgInfo(TestType tt, const std::vector<std::string>& paramNames, const std::string& tmpl)
+    : check(tt)
+    , msgTemplate(tmpl, paramNames)
+  {
+    if ( msgTemplate.valueCount() > MsgParams::MAX_COUNT )
+      throw std::logic_error("Too many parameters in message template: " + tmpl);
+
+    // The parameters are output in JSON in the order of their names
+    for ( size_t i = 0; i < paramNames.size(); ++i )
+      jsonParams.push_back({paramNames[i], i});
+    std::sort(jsonParams.begin(), jsonParams.end());
+  }
+
   TestType check;
-  std::string msgTemplate;
-};
+  MsgTemplate msgTemplate;
 
-std::unordered_map<MsgId, MsgInfo> msgTable = {
-  { MsgId::CHECKSUM,         { TestType::CHECKSUM, "ZIM Archive Checksum in archive: {{&archive_checksum}}\n" } },
-  { MsgId::MAIN_PAGE,        { TestType::MAIN_PAGE, "Main Page Index stored in Archive Header: {{&main_page_index}}" } },
-  { MsgId::EMPTY_ENTRY,      { TestType::EMPTY, "Entry {{&path}} is empty" } },
-  { MsgId::OUTOFBOUNDS_LINK, { TestType::URL_INTERNAL, "{{&link}} is out of bounds. Article: {{&path}}" } },
-  { MsgId::DANGLING_LINKS,   { TestType::URL_INTERNAL, "The following links:\n{{#links}}- {{&value}}\n{{/links}}({{&normalized_link}}) were not found in article {{&path}}" } },
-  { MsgId::EXTERNAL_LINK,    { TestType::URL_EXTERNAL, "{{&link}} is an external dependence in article {{&path}}" } },
-  { MsgId::EMPTY_LINKS,      { TestType::URL_EMPTY, "Found {{&count}} empty links in article: {{&path}}" } },
-  { MsgId::REDUNDANT_ITEMS,  { TestType::REDUNDANT, "{{&path1}} and {{&path2}}" } },
-  { MsgId::METADATA,         { TestType::METADATA, "{{&error}}" } },
-  { MsgId::REDIRECT_LOOP,    { TestType::REDIRECT, "Redirect loop exists from entry {{&entry_path}}\n"  } },
-  { MsgId::MISSING_FAVICON,  { TestType::FAVICON, "Favicon is missing" } }
+  // Names of the parameters with their index in MsgParams (the index of the
+  // list being the count of values)
+  std::vector<std::pair<std::string, size_t>> jsonParams;
 };
 
-using kainjow::mustache::mustache;
+// The templates are compiled once, at startup
+const std::unordered_map<MsgId, MsgInfo> msgTable = {
+  { MsgId::CHECKSUM,         { TestType::CHECKSUM, {"archive_checksum"}, "ZIM Archive Checksum in archive: {{&archive_checksum}}\n" } },
+  { MsgId::MAIN_PAGE,        { TestType::MAIN_PAGE, {"main_page_index"}, "Main Page Index stored in Archive Header: {{&main_page_index}}" } },
+  { MsgId::EMPTY_ENTRY,      { TestType::EMPTY, {"path"}, "Entry {{&path}} is empty" } },
+  { MsgId::OUTOFBOUNDS_LINK, { TestType::URL_INTERNAL, {"link", "path"}, "{{&link}} is out of bounds. Article: {{&path}}" } },
+  { MsgId::DANGLING_LINKS,   { TestType::URL_INTERNAL, {"path", "normalized_link", "links"}, "The following links:\n{{#links}}- {{&value}}\n{{/links}}({{&normalized_link}}) were not found in article {{&path}}" } },
+  { MsgId::EXTERNAL_LINK,    { TestType::URL_EXTERNAL, {"link", "path"}, "{{&link}} is an external dependence in article {{&path}}" } },
+  { MsgId::EMPTY_LINKS,      { TestType::URL_EMPTY, {"count", "path"}, "Found {{&count}} empty links in article: {{&path}}" } },
+  { MsgId::REDUNDANT_ITEMS,  { TestType::REDUNDANT, {"path1", "path2"}, "{{&path1}} and {{&path2}}" } },
+  { MsgId::METADATA,         { TestType::METADATA, {"error"}, "{{&error}}" } },
+  { MsgId::REDIRECT_LOOP,    { TestType::REDIRECT, {"entry_path"}, "Redirect loop exists from entry {{&entry_path}}\n"  } },
+  { MsgId::MISSING_FAVICON,  { TestType::FAVICON, {}, "Favicon is missing" } }
+};
 
 template<typename T>
 std::string toStr(T t)
@@ -86,11 +223,9 @@ const char* toStr(TestType tt) {
   };
 }
 
-typedef std::map<MsgParams::key_type, MsgParams::mapped_type> SortedMsgParams;
-SortedMsgParams sortedMsgParams(const MsgParams& msgParams)
-{
-  return SortedMsgParams(msgParams.begin(), msgParams.end());
-}
+// Serializes the output of the lines in NDJSON format (the messages of
+// several files checked concurrently go to the same stream)
+std::mutex ndjsonOutputMutex;
 
 bool areAliases(const zim::Item& i1, const zim::Item& i2)
 {
@@ -99,35 +234,6 @@ bool areAliases(const zim::Item& i1, const zim::Item& i2)
 
 } // unnamed namespace
 
-namespace JSON
-{
-
-OutputStream& operator<<(OutputStream& out, const kainjow::mustache::data& d)
-{
-  if (d.is_string()) {
-    out << d.string_value();
-  } else if (d.is_list()) {
-    out << startArray;
-    for ( const auto& el : d.list_value() ) {
-      out << el;
-    }
-    out << endArray;
-  } else if (d.is_object()) {
-    // HACK: kainjow::mustache::data wrapping a kainjow::mustache::object
-    // HACK: doesn't provide direct access to the object or its keys.
-    // HACK: So assuming that an object is only used to wrap a string or a list
-    // HACK: under a hardcoded key 'value'
-    const auto* v = d.get("value");
-    if ( v )
-      out << *v;
-  } else {
-    out << "!!! UNSUPPORTED DATA TYPE !!!";
-  }
-  return out;
-}
-
-} // namespace JSON
-
 JSON::OutputStream& operator<<(JSON::OutputStream& out, TestType check)
 {
   return out << toStr(check);
@@ -145,75 +251,293 @@ JSON::OutputStream& operator<<(JSON::OutputStream& out, EnabledTests checks)
   return out;
 }
 
-ErrorLogger::ErrorLogger(bool _jsonOutputMode)
+MsgParams::MsgParams(std::initializer_list<std::string> vals, List list)
+  : count(vals.size())
+  , listValue(std::move(list))
+{
+    if ( count > MAX_COUNT )
+      throw std::logic_error("Too many parameters of a message");
+    std::copy(vals.begin(), vals.end(), values.begin());
+}
+
+ErrorLogger::ErrorLogger(OutputFormat _format, std::ostream& _out)
   : reportMsgs(size_t(TestType::COUNT))
-  , jsonOutputStream(_jsonOutputMode ? &std::cout : nullptr)
+  , format(_format)
+  , out(_out)
+  , jsonOutputStream(_format == OutputFormat::TEXT ? nullptr :
+                     _format == OutputFormat::NDJSON ? &summaryOutput : &_out,
+                     _format != OutputFormat::JSON)
 {
     testStatus.set();
     jsonOutputStream << JSON::startObject;
 }
 
+ErrorLogger::ErrorLogger(std::unique_ptr<std::ostringstream> buffer)
+  : reportMsgs(size_t(TestType::COUNT))
+  , format(OutputFormat::TEXT)
+  , deferredOutput(std::move(buffer))
+  , out(*deferredOutput)
+  , jsonOutputStream(nullptr)
+{
+    testStatus.set();
+}
+
 ErrorLogger::~ErrorLogger()
 {
     jsonOutputStream << JSON::endObject;
+    if ( format == OutputFormat::NDJSON ) {
+        std::lock_guard<std::mutex> lock(ndjsonOutputMutex);
+        out << summaryOutput.str() << std::flush;
+    }
+}
+
+std::unique_ptr<ErrorLogger> ErrorLogger::makeDeferred() const
+{
+    return std::unique_ptr<ErrorLogger>(new ErrorLogger(std::make_unique<std::ostringstream>()));
+}
+
+void ErrorLogger::mergeDeferred(ErrorLogger& deferred)
+{
+    assert(deferred.deferredOutput);
+    std::lock_guard<std::mutex> lock(deferred.deferredMutex);
+    if ( format == OutputFormat::TEXT ) {
+        out << deferred.deferredOutput->str() << std::flush;
+    }
+    for ( auto& msg : deferred.deferredMsgs ) {
+        if ( format == OutputFormat::NDJSON ) {
+            streamMsg(msg);
+        } else {
+            storeMsg(std::move(msg));
+        }
+    }
+    deferred.deferredMsgs.clear();
+    testStatus &= deferred.testStatus;
+    deferred.forwardTo = this;
 }
 
 void ErrorLogger::infoMsg(const std::string& msg) const {
-  if ( !jsonOutputStream.enabled() ) {
-    std::cout << msg << std::endl;
+  std::unique_lock<std::mutex> lock(deferredMutex, std::defer_lock);
+  if ( deferredOutput ) {
+    lock.lock();
+    if ( forwardTo ) {
+      forwardTo->infoMsg(msg);
+      return;
+    }
+  }
+
+  if ( format == OutputFormat::TEXT ) {
+    out << msg << std::endl;
   }
 }
 
 void ErrorLogger::setTestResult(TestType type, bool status) {
-    testStatus[size_t(type)] = status;
+  std::unique_lock<std::mutex> lock(deferredMutex, std::defer_lock);
+  if ( deferredOutput ) {
+    lock.lock();
+    if ( forwardTo ) {
+      forwardTo->setTestResult(type, status);
+      return;
+    }
+  }
+
+  testStatus[size_t(type)] = status;
 }
 
 void ErrorLogger::addMsg(MsgId msgid, const MsgParams& msgParams)
 {
+  std::unique_lock<std::mutex> lock(deferredMutex, std::defer_lock);
+  if ( deferredOutput ) {
+    lock.lock();
+    if ( forwardTo ) {
+      forwardTo->addMsg(msgid, msgParams);
+      return;
+    }
+  }
+
   const MsgInfo& m = msgTable.at(msgid);
-  setTestResult(m.check, false);
-  reportMsgs[size_t(m.check)].push_back({msgid, msgParams});
+  if ( msgParams.size() != m.msgTemplate.valueCount() )
+    throw std::logic_error("Invalid number of parameters of a message");
+  testStatus[size_t(m.check)] = false;
+  if ( deferredOutput ) {
+    deferredMsgs.push_back({msgid, msgParams});
+  } else if ( format == OutputFormat::NDJSON ) {
+    streamMsg({msgid, msgParams});
+  } else {
+    storeMsg({msgid, msgParams});
+  }
+}
+
+namespace
+{
+
+// Approximate memory used by a message waiting for the report
+size_t msgMemoryUsage(const MsgParams& msgParams)
+{
+  size_t usage = 128;
+  for ( size_t i = 0; i < msgParams.size(); ++i )
+    usage += msgParams[i].size();
+  for ( const auto& el : msgParams.list() )
+    usage += sizeof(el) + el.size();
+  return usage;
+}
+
+void writeMsgString(std::FILE* f, const std::string& s)
+{
+  const uint32_t size = s.size();
+  std::fwrite(&size, sizeof(size), 1, f);
+  std::fwrite(s.data(), 1, s.size(), f);
+}
+
+bool readMsgString(std::FILE* f, std::string& s)
+{
+  uint32_t size;
+  if ( std::fread(&size, sizeof(size), 1, f) != 1 )
+    return false;
+  s.resize(size);
+  return std::fread(&s[0], 1, size, f) == size;
+}
+
+void writeMsg(std::FILE* f, MsgId msgId, const MsgParams& msgParams)
+{
+  const uint32_t header[3] = { uint32_t(msgId), uint32_t(msgParams.size()), uint32_t(msgParams.list().size()) };
+  std::fwrite(header, sizeof(header), 1, f);
+  for ( size_t i = 0; i < msgParams.size(); ++i )
+    writeMsgString(f, msgParams[i]);
+  for ( const auto& el : msgParams.list() )
+    writeMsgString(f, el);
+}
+
+bool readMsg(std::FILE* f, MsgId& msgId, MsgParams& msgParams)
+{
+  uint32_t header[3];
+  if ( std::fread(header, sizeof(header), 1, f) != 1 || header[1] > MsgParams::MAX_COUNT )
+    return false;
+  std::string values[MsgParams::MAX_COUNT];
+  for ( size_t i = 0; i < header[1]; ++i ) {
+    if ( !readMsgString(f, values[i]) )
+      return false;
+  }
+  MsgParams::List list(header[2]);
+  for ( auto& el : list ) {
+    if ( !readMsgString(f, el) )
+      return false;
+  }
+  msgId = MsgId(header[0]);
+  switch ( header[1] ) {
+    case 0: msgParams = MsgParams({}, std::move(list)); break;
+    case 1: msgParams = MsgParams({values[0]}, std::move(list)); break;
+    default: msgParams = MsgParams({values[0], values[1]}, std::move(list)); break;
+  }
+  return true;
+}
+
+} // unnamed namespace
+
+void ErrorLogger::storeMsg(MsgIdWithParams&& msg)
+{
+  msgMemory += msgMemoryUsage(msg.msgParams);
+  reportMsgs[size_t(msgTable.at(msg.msgId).check)].push_back(std::move(msg));
+  if ( msgMemory > msgMemoryLimit )
+    spillMsgs();
+}
 
+void ErrorLogger::spillMsgs()
+{
+  spilledMsgs.resize(reportMsgs.size());
+  for ( size_t i = 0; i < reportMsgs.size(); ++i ) {
+    if ( reportMsgs[i].empty() )
+      continue;
+    auto& file = spilledMsgs[i];
+    if ( !file )
+      file.reset(std::tmpfile());
+    if ( !file )
+      throw std::runtime_error("Cannot create a temporary file");
+    for ( const auto& msg : reportMsgs[i] )
+      writeMsg(file.get(), msg.msgId, msg.msgParams);
+    if ( std::fflush(file.get()) != 0 || std::ferror(file.get()) )
+      throw std::runtime_error("Cannot write to a temporary file");
+    reportMsgs[i].clear();
+    reportMsgs[i].shrink_to_fit();
+  }
+  msgMemory = 0;
+}
+
+// Calls f() for every message of the i'th test/check, in the order of
+// their production
+template<class F>
+void ErrorLogger::forEachMsg(size_t i, F f) const
+{
+  if ( i < spilledMsgs.size() && spilledMsgs[i] ) {
+    std::FILE* const file = spilledMsgs[i].get();
+    std::rewind(file);
+    MsgIdWithParams msg;
+    while ( readMsg(file, msg.msgId, msg.msgParams) )
+      f(msg);
+  }
+  for ( const auto& msg : reportMsgs[i] )
+    f(msg);
 }
 
 std::string ErrorLogger::expand(const MsgIdWithParams& msg)
 {
-  const MsgInfo& m = msgTable.at(msg.msgId);
-  mustache tmpl{m.msgTemplate};
-  return tmpl.render(msg.msgParams);
+  std::string result;
+  msgTable.at(msg.msgId).msgTemplate.render(result, msg.msgParams);
+  return result;
 }
 
-void ErrorLogger::jsonOutput(const MsgIdWithParams& msg) const {
+void ErrorLogger::jsonOutput(JSON::OutputStream& stream, const MsgIdWithParams& msg) const {
   const MsgInfo& m = msgTable.at(msg.msgId);
-  jsonOutputStream << JSON::startObject;
-  jsonOutputStream << JSON::property("check", m.check);
-  jsonOutputStream << JSON::property("level", tagToStr[errormapping[m.check].first]);
-  jsonOutputStream << JSON::property("message", expand(msg));
+  stream << JSON::startObject;
+  if ( format == OutputFormat::NDJSON ) {
+    stream << JSON::property("file_name", fileName);
+  }
+  stream << JSON::property("check", m.check);
+  stream << JSON::property("level", tagToStr.at(errormapping.at(m.check).first));
+  stream << JSON::property("message", expand(msg));
 
-  for ( const auto& kv : sortedMsgParams(msg.msgParams) ) {
-    jsonOutputStream << JSON::property(kv.first, kv.second);
+  for ( const auto& param : m.jsonParams ) {
+    if ( param.second < msg.msgParams.size() ) {
+      stream << JSON::property(param.first, msg.msgParams[param.second]);
+    } else {
+      stream << JSON::property(param.first, JSON::startArray);
+      for ( const auto& el : msg.msgParams.list() ) {
+        stream << el;
+      }
+      stream << JSON::endArray;
+    }
+  }
+  stream << JSON::endObject;
+}
+
+void ErrorLogger::streamMsg(const MsgIdWithParams& msg) const {
+  std::ostringstream line;
+  {
+    JSON::OutputStream stream(&line, true);
+    jsonOutput(stream, msg);
   }
-  jsonOutputStream << JSON::endObject;
+  std::lock_guard<std::mutex> lock(ndjsonOutputMutex);
+  out << line.str() << std::flush;
 }
 
 void ErrorLogger::report(bool error_details) const {
-    if ( jsonOutputStream.enabled() ) {
+    if ( format == OutputFormat::NDJSON ) {
+        // The messages were output as soon as they were found
+    } else if ( jsonOutputStream.enabled() ) {
         jsonOutputStream << JSON::property("logs", JSON::startArray);
         for ( size_t i = 0; i < size_t(TestType::COUNT); ++i ) {
-            for (const auto& msg: reportMsgs[i]) {
-                jsonOutput(msg);
-            }
+            forEachMsg(i, [this](const MsgIdWithParams& msg) {
+                jsonOutput(jsonOutputStream, msg);
+            });
         }
         jsonOutputStream << JSON::endArray;
     } else {
         for ( size_t i = 0; i < size_t(TestType::COUNT); ++i ) {
-            const auto& testmsg = reportMsgs[i];
             if ( !testStatus[i] ) {
-                auto &p = errormapping[TestType(i)];
-                std::cout << "[" + tagToStr[p.first] + "] " << p.second << ":" << std::endl;
-                for (auto& msg: testmsg) {
-                    std::cout << "  " << expand(msg) << std::endl;
-                }
+                auto &p = errormapping.at(TestType(i));
+                out << "[" + tagToStr.at(p.first) + "] " << p.second << ":" << std::endl;
+                forEachMsg(i, [this](const MsgIdWithParams& msg) {
+                    out << "  " << expand(msg) << std::endl;
+                });
             }
         }
     }
@@ -221,7 +545,7 @@ void ErrorLogger::report(bool error_details) const {
 
 bool ErrorLogger::overallStatus() const {
     for ( size_t i = 0; i < size_t(TestType::COUNT); ++i ) {
-        if (errormapping[TestType(i)].first == LogTag::ERROR) {
+        if (errormapping.at(TestType(i)).first == LogTag::ERROR) {
             if ( testStatus[i] == false ) {
                 return false;
             }
@@ -231,22 +555,201 @@ bool ErrorLogger::overallStatus() const {
 }
 
 
+namespace
+{
+
+// Sequential reader of a ZIM file, which can be split in several parts
+// (file.zimaa, file.zimab, ...) as accepted by zim::Archive. The reading
+// can start at any offset of the file.
+class ZimFileReader
+{
+public: // functions
+    explicit ZimFileReader(const std::string& filename)
+    {
+        if ( std::ifstream(filename) ) {
+            parts.push_back(filename);
+        } else {
+            for ( size_t i = 0; i < 26 * 26; ++i ) {
+                const std::string part = filename + char('a' + i / 26) + char('a' + i % 26);
+                if ( !std::ifstream(part) )
+                    break;
+                parts.push_back(part);
+            }
+        }
+        if ( parts.empty() )
+            throw std::runtime_error("Cannot open ZIM file " + filename);
+    }
+
+    // Reads size bytes (less only at the end of the file) and returns the
+    // count of bytes read
+    size_t read(char* data, size_t size)
+    {
+        size_t count = 0;
+        while ( count < size ) {
+            if ( !in.is_open() || in.eof() ) {
+                if ( nextPart == parts.size() )
+                    break;
+                in = std::ifstream(parts[nextPart++], std::ios::binary);
+                if ( !in )
+                    throw std::runtime_error("Cannot open ZIM file " + parts[nextPart - 1]);
+            }
+            in.read(data + count, size - count);
+            count += in.gcount();
+            if ( !in && !in.eof() )
+                throw std::runtime_error("Error reading ZIM file " + parts[nextPart - 1]);
+        }
+        return count;
+    }
+
+    void seek(uint64_t offset)
+    {
+        for ( nextPart = 0; nextPart + 1 < parts.size(); ++nextPart ) {
+            const uint64_t partSize = getPartSize(nextPart);
+            if ( offset < partSize )
+                break;
+            offset -= partSize;
+        }
+        in = std::ifstream(parts[nextPart++], std::ios::binary);
+        if ( !in.seekg(offset) )
+            throw std::runtime_error("Error reading ZIM file " + parts[nextPart - 1]);
+    }
+
+private: // functions
+    uint64_t getPartSize(size_t part)
+    {
+        if ( partSizes.size() <= part ) {
+            partSizes.resize(parts.size());
+            for ( size_t i = 0; i < parts.size(); ++i )
+                partSizes[i] = std::ifstream(parts[i], std::ios::binary | std::ios::ate).tellg();
+        }
+        return partSizes[part];
+    }
+
+private: // data
+    std::vector<std::string> parts;
+    std::vector<uint64_t> partSizes;
+    size_t nextPart = 0;
+    std::ifstream in;
+};
+
+// Lets the (compressed) content of a cluster be hashed without decompressing
+// it.
+class ClusterSpans
+{
+public: // functions
+    explicit ClusterSpans(const zim::Archive& archive)
+        : ranges(archive)
+    {}
+
+    Hash128 hash(zim::cluster_index_type cluster, ZimFileReader& reader, std::string& buffer) const
+    {
+        buffer.resize(ranges.size(cluster));
+        reader.seek(ranges.offset(cluster));
+        if ( reader.read(&buffer[0], buffer.size()) != buffer.size() )
+            throw std::runtime_error("Error reading cluster " + toStr(cluster));
+        return hash128(buffer);
+    }
+
+private: // data
+    const ClusterRanges ranges;
+};
+
+// Computes the MD5 checksum of a ZIM file in a single sequential pass and
+// compares it with the checksum stored in the file. This avoids the random
+// accesses of zim::Archive::check() and lets the pass run concurrently with
+// the article checks (which read the clusters in the order of the file).
+bool verifyChecksum(const std::string& filename, std::string& storedChecksum)
+{
+    const size_t BUFFER_SIZE = 1024 * 1024;
+    const size_t HEADER_SIZE = 80;
+    // Offset of the position of the checksum in the header
+    const size_t CHECKSUM_POS_OFFSET = 72;
+
+    ZimFileReader reader(filename);
+    std::vector<char> buffer(BUFFER_SIZE);
+    size_t size = reader.read(buffer.data(), buffer.size());
+    if ( size < HEADER_SIZE )
+        return false;
+
+    uint64_t checksumPos = 0;
+    for ( size_t i = 0; i < 8; ++i )
+        checksumPos |= uint64_t(uint8_t(buffer[CHECKSUM_POS_OFFSET + i])) << (8*i);
+
+    Md5 md5;
+    Md5::Digest checksum;
+    size_t checksumSize = 0;
+    for ( uint64_t offset = 0; size != 0 && checksumSize < checksum.size(); ) {
+        if ( offset < checksumPos ) {
+            md5.update(buffer.data(), std::min<uint64_t>(size, checksumPos - offset));
+        }
+        for ( uint64_t pos = std::max(offset, checksumPos);
+              pos < offset + size && checksumSize < checksum.size(); ++pos ) {
+            checksum[checksumSize++] = uint8_t(buffer[pos - offset]);
+        }
+        offset += size;
+        size = reader.read(buffer.data(), buffer.size());
+    }
+
+    if ( checksumSize < checksum.size() )
+        return false;
+
+    storedChecksum = Md5::toHex(checksum);
+    return md5.digest() == checksum;
+}
+
+} // unnamed namespace
+
+void test_checksum(const std::string& filename, ErrorLogger& reporter) {
+    reporter.infoMsg("[INFO] Verifying Internal Checksum...");
+    std::string storedChecksum;
+    if (!verifyChecksum(filename, storedChecksum)) {
+        reporter.infoMsg("  [ERROR] Wrong Checksum in ZIM archive");
+        reporter.addMsg(MsgId::CHECKSUM, {storedChecksum});
+    }
+}
+
 void test_checksum(zim::Archive& archive, ErrorLogger& reporter) {
     reporter.infoMsg("[INFO] Verifying Internal Checksum...");
     bool result = archive.check();
     if (!result) {
         reporter.infoMsg("  [ERROR] Wrong Checksum in ZIM archive");
-        reporter.addMsg(MsgId::CHECKSUM, {{"archive_checksum", archive.getChecksum()}});
+        reporter.addMsg(MsgId::CHECKSUM, {archive.getChecksum()});
     }
 }
 
-bool test_integrity(const std::string& filename, ErrorLogger& reporter) {
+namespace
+{
+
+bool validate(const std::string& filename, const zim::IntegrityCheckList& checks, ErrorLogger& reporter)
+{
+    bool result = zim::validate(filename, checks);
+    if (!result) {
+        reporter.setTestResult(TestType::INTEGRITY, false);
+        reporter.infoMsg("  [ERROR] ZIM file's low level structure is invalid");
+    }
+    return result;
+}
+
+} // unnamed namespace
+
+bool test_integrity_structure(const std::string& filename, ErrorLogger& reporter) {
     reporter.infoMsg("[INFO] Verifying ZIM-archive structure integrity...");
     zim::IntegrityCheckList checks;
-    checks.set(); // enable all checks (including checksum)
-    bool result = zim::validate(filename, checks);
-    reporter.setTestResult(TestType::INTEGRITY, result);
+    checks.set();
+    checks.reset(size_t(zim::IntegrityCheck::CHECKSUM));
+    return validate(filename, checks, reporter);
+}
+
+bool test_integrity_checksum(const std::string& filename, ErrorLogger& reporter) {
+    std::string storedChecksum;
+    bool result = false;
+    try {
+        result = verifyChecksum(filename, storedChecksum);
+    } catch (const std::exception&) {
+        // Same as zim::validate(): an unreadable file is invalid
+    }
     if (!result) {
+        reporter.setTestResult(TestType::INTEGRITY, false);
         reporter.infoMsg("  [ERROR] ZIM file's low level structure is invalid");
     }
     return result;
@@ -260,7 +763,7 @@ void test_metadata(const zim::Archive& archive, ErrorLogger& reporter) {
         metadata.set(key, archive.getMetadata(key));
     }
     for (const auto &error : metadata.check()) {
-        reporter.addMsg(MsgId::METADATA, {{"error", error}});
+        reporter.addMsg(MsgId::METADATA, {error});
     }
 }
 
@@ -281,50 +784,333 @@ void test_mainpage(const zim::Archive& archive, ErrorLogger& reporter) {
         testok = false;
     }
     if (!testok) {
-        reporter.addMsg(MsgId::MAIN_PAGE, {{"main_page_index", toStr(archive.getMainEntryIndex())}});
+        reporter.addMsg(MsgId::MAIN_PAGE, {toStr(archive.getMainEntryIndex())});
     }
 }
 
 namespace
 {
 
+// All entries stored in the same cluster. Such a group is the unit of work
+// of the article checking threads: the cluster is then decompressed only once
+// and by a single thread.
+struct ClusterTask
+{
+    // Position of the task in the sequence of tasks
+    size_t seqNo = 0;
+    std::vector<zim::Entry> entries;
+
+    // When the task was submitted to the worker pool
+    std::chrono::steady_clock::time_point submitTime;
+};
+
+// Adds the time elapsed during its lifetime to a duration (if any)
+class ScopedTimer
+{
+public: // functions
+    explicit ScopedTimer(ArticleCheckProfile::Duration* _total)
+        : total(_total)
+    {
+        if ( total )
+            start = std::chrono::steady_clock::now();
+    }
+
+    ~ScopedTimer()
+    {
+        stop();
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    void stop()
+    {
+        if ( total )
+            *total += std::chrono::steady_clock::now() - start;
+        total = nullptr;
+    }
+
+private: // data
+    ArticleCheckProfile::Duration* total;
+    std::chrono::steady_clock::time_point start;
+};
+
+// ArticleChecker::check() can be called concurrently from several threads.
+//
+// The state that is modified by the checks is either owned by a worker thread
+// (WorkerData) or by a task (TaskContext), thus no locking is needed while
+// checking the entries. The messages of a task are passed to the ErrorLogger
+// after the task is complete, in the order of the tasks. This makes the
+// output independent of the count of threads.
 class ArticleChecker
 {
 public: // types
-    typedef std::vector<html_link> LinkCollection;
+    typedef HtmlLinkCollection LinkCollection;
 
 public: // functions
-    ArticleChecker(const zim::Archive& _archive, ErrorLogger& _reporter, ProgressBar& _progress, EnabledTests _checks)
+    // The results of the checks of the clusters are taken from (and recorded
+    // in) a cluster cache if it is used
+    struct ClusterCaching
+    {
+        const ClusterSpans& spans;
+        const ClusterCache& cache;
+        ClusterCacheWriter& writer;
+    };
+
+    // The options are those of test_articles() (with the memory limits
+    // lowered to fit in the memory budget). The fingerprints beyond
+    // fingerprintMaxMemory are spilled to disk.
+    ArticleChecker(const zim::Archive& _archive, ErrorLogger& _reporter, ProgressBar& _progress, EnabledTests _checks,
+                   const ArticleCheckOptions& options, unsigned threadCount, const PathIndex* _pathIndex,
+                   const ClusterCaching* _clusterCaching, size_t _fingerprintMaxMemory)
         : archive(_archive)
         , reporter(_reporter)
         , progress(_progress)
         , checks(_checks)
+        , verifyRedundant(options.verify_redundant)
+        , pathIndex(_pathIndex)
+        , clusterCaching(_clusterCaching)
+        , profiling(options.profile)
+        , collectLinkGraph(collectsLinkGraph(options, _checks))
+        , workerData(threadCount)
         , linkStatusCache(64*1024)
+        , linkTargetCache(collectLinkGraph ? 64*1024 : 1)
+        , linkTable(options.link_table_max_mb * 1024 * 1024)
     {
-        progress.reset(archive.getEntryCount());
+        progress.reset(archive.getEntryCount(), "articles");
+        // Beyond the memory limit, the fingerprints are spilled to disk
+        const size_t maxItems = _fingerprintMaxMemory / threadCount / sizeof(ItemFingerprint);
+        for ( auto& wd : workerData )
+            wd.fingerprints = SortedRuns<ItemFingerprint>(maxItems);
     }
 
 
-    void check(zim::Entry entry);
+    // The link graph needs the targets of the links, which the index of
+    // entry paths doesn't provide
+    static bool collectsLinkGraph(const ArticleCheckOptions& options, EnabledTests checks)
+    {
+        return !options.link_graph.empty() && checks.isEnabled(TestType::URL_INTERNAL);
+    }
+
+    void check(const ClusterTask& task, size_t workerIndex);
+    // Drops a task without checking its entries (once the checks are
+    // cancelled)
+    void skip(const ClusterTask& task) { submitMsgs(task.seqNo, MsgList()); }
     void detect_redundant_articles();
 
+    size_t checkedEntryCount() const { return checkedEntries; }
+    size_t failedEntryCount() const { return failedEntries; }
+    size_t cachedClusterCount() const { return cachedClusters; }
+    size_t distinctLinkCount() const { return linkTable.size(); }
+
+    // Sum of the profiles of the workers
+    ArticleCheckProfile profile() const;
+
+    // Graph of the internal links of the checked entries (if collected)
+    // and indices of the pages among them
+    LinkGraph linkGraph() const;
+    std::vector<zim::entry_index_type> pages() const;
+
 private: // types
-    typedef std::vector<std::string> StringCollection;
+    // An internal link and its normalized form (stored in
+    // WorkerData::normalizedLinks)
+    struct NormalizedLink
+    {
+        size_t offset;
+        size_t size;
+        std::string_view link;
+    };
 
-    // collection of links grouped into sets of equivalent normalized links
-    typedef std::map<std::string, StringCollection> GroupedLinkCollection;
+    // collection of links sorted by normalized link (links with the same
+    // normalized link keep their order of appearance)
+    typedef std::vector<NormalizedLink> GroupedLinkCollection;
+
+    struct Msg
+    {
+      MsgId msgId;
+      MsgParams msgParams;
+    };
+
+    typedef std::vector<Msg> MsgList;
+
+    struct ItemFingerprint
+    {
+        zim::size_type size;
+        Hash128 hash;
+        zim::entry_index_type index;
+        zim::cluster_index_type cluster;
+        zim::blob_index_type blob;
+
+        bool sameContentAs(const ItemFingerprint& other) const
+        {
+            return size == other.size && hash == other.hash;
+        }
+
+        bool isAliasOf(const ItemFingerprint& other) const
+        {
+            return cluster == other.cluster && blob == other.blob;
+        }
+
+        bool operator<(const ItemFingerprint& other) const
+        {
+            if ( size != other.size )
+                return size < other.size;
+            if ( hash != other.hash )
+                return hash < other.hash;
+            return index < other.index;
+        }
+    };
+
+    // Data accumulated by a single worker thread
+    struct WorkerData
+    {
+        // fingerprints of all the items, for the redundancy check
+        SortedRuns<ItemFingerprint> fingerprints;
+
+        // Buffers reused from one item to the next one, in order to save
+        // on memory allocations
+        LinkCollection links;
+        GroupedLinkCollection groupedLinks;
+        std::string normalizedLinks;
+        std::string normalizedLink;
+
+        // Reader of the raw clusters, for the cluster cache
+        std::unique_ptr<ZimFileReader> fileReader;
+        std::string clusterData;
+
+        ArticleCheckProfile profile;
+
+        // Links of the checked entries and pages among them, for the link
+        // graph
+        LinkGraph::Part linkGraph;
+        std::vector<LinkGraph::Node> linkTargets;
+        std::vector<zim::entry_index_type> pages;
+    };
+
+    struct TaskContext
+    {
+        WorkerData& workerData;
+        MsgList msgs;
+
+        // Results of the checks of the cluster (possibly found in the
+        // cluster cache), if the cluster cache is used
+        ClusterResult* clusterResult = nullptr;
+
+        void addMsg(MsgId msgid, MsgParams msgParams)
+        {
+            msgs.push_back({msgid, std::move(msgParams)});
+        }
+    };
 
 private: // functions
-    void check_item(const zim::Item& item);
-    void check_internal_links(zim::Item item, const LinkCollection& links);
-    void check_internal_links(zim::Item item, const GroupedLinkCollection& groupedLinks);
-    void check_external_links(zim::Item item, const LinkCollection& links);
+    void check(zim::Entry entry, TaskContext& ctx);
+    bool findCachedResult(const ClusterTask& task, TaskContext& ctx, Hash128& clusterHash, ClusterResult& result);
+    void check_item(const zim::Item& item, TaskContext& ctx);
+    void check_links(zim::Item item, const LinkCollection& links, TaskContext& ctx);
+    void check_internal_links(zim::Item item, const GroupedLinkCollection& groupedLinks, TaskContext& ctx);
+
+    void submitMsgs(size_t seqNo, MsgList&& msgs);
 
-    bool is_valid_internal_link(const std::string& link)
+    template<class Iter>
+    void report_redundant_items(Iter begin, Iter end);
+    template<class Iter>
+    void verify_redundant_items(Iter begin, Iter end);
+
+    bool is_valid_internal_link(const std::string& link, TaskContext& ctx)
     {
-      return linkStatusCache.getOrPut(link, [=](){
+      ArticleCheckProfile& profile = ctx.workerData.profile;
+      ++profile.link_lookups;
+
+      // A path missing from the index may still be valid (e.g. if it is
+      // a path in the old namespace scheme, still supported by libzim).
+      if ( pathIndex && pathIndex->contains(link) ) {
+        ++profile.path_index_hits;
+        return true;
+      }
+
+      bool miss = false;
+      const bool valid = linkStatusCache.getOrPut(link, [&](){
+                miss = true;
                 return archive.hasEntryByPath(link);
       });
+      ++(miss ? profile.link_cache_misses : profile.link_cache_hits);
+      return valid;
+    }
+
+    // Same as is_valid_internal_link(), recording the target of the link
+    // in WorkerData::linkTargets for the link graph
+    bool find_internal_link_target(const std::string& link, TaskContext& ctx)
+    {
+      ArticleCheckProfile& profile = ctx.workerData.profile;
+      ++profile.link_lookups;
+
+      bool miss = false;
+      const auto target = linkTargetCache.getOrPut(link, [&](){
+                miss = true;
+                try {
+                    return int64_t(archive.getEntryByPath(link).getIndex());
+                } catch (const zim::EntryNotFound&) {
+                    return int64_t(-1);
+                }
+      });
+      ++(miss ? profile.link_cache_misses : profile.link_cache_hits);
+      if ( target < 0 )
+        return false;
+      ctx.workerData.linkTargets.push_back(target);
+      return true;
+    }
+
+    // Checks an internal link through the table of links, so that it is
+    // resolved only once for all the articles. Falls back on the caches of
+    // link statuses or targets once the table is full.
+    bool check_internal_link(const std::string& link, TaskContext& ctx)
+    {
+      ArticleCheckProfile& profile = ctx.workerData.profile;
+      LinkTable::Link l;
+      const bool interned = linkTable.intern(link, l, [&](const std::string& link) {
+                return resolve_internal_link(link, ctx);
+      });
+      if ( !interned ) {
+        return collectLinkGraph ? find_internal_link_target(link, ctx)
+                                : is_valid_internal_link(link, ctx);
+      }
+
+      ++profile.link_lookups;
+      if ( !l.resolved )
+        ++profile.link_cache_hits;
+      if ( l.target == DANGLING_LINK )
+        return false;
+      if ( collectLinkGraph )
+        ctx.workerData.linkTargets.push_back(l.target);
+      return true;
+    }
+
+    // Resolution of a link interned in the table of links: the entry index
+    // of its target if the link graph is collected, VALID_LINK otherwise, or
+    // DANGLING_LINK
+    LinkTable::Target resolve_internal_link(const std::string& link, TaskContext& ctx) const
+    {
+      ArticleCheckProfile& profile = ctx.workerData.profile;
+      if ( !collectLinkGraph && pathIndex && pathIndex->contains(link) ) {
+        ++profile.path_index_hits;
+        return VALID_LINK;
+      }
+
+      ++profile.link_cache_misses;
+      if ( !collectLinkGraph )
+        return archive.hasEntryByPath(link) ? VALID_LINK : DANGLING_LINK;
+      try {
+        return archive.getEntryByPath(link).getIndex();
+      } catch (const zim::EntryNotFound&) {
+        return DANGLING_LINK;
+      }
+    }
+
+    // Times the enclosing scope into the given field of the profile of the
+    // worker (if profiling)
+    ScopedTimer timer(TaskContext& ctx, ArticleCheckProfile::Duration ArticleCheckProfile::*d) const
+    {
+      return ScopedTimer(profiling ? &(ctx.workerData.profile.*d) : nullptr);
     }
 
 private: // data
@@ -332,366 +1118,960 @@ private: // data
     ErrorLogger& reporter;
     ProgressBar& progress;
     const EnabledTests checks;
+    const bool verifyRedundant;
+    const PathIndex* const pathIndex;
+    const ClusterCaching* const clusterCaching;
+    const bool profiling;
+    const bool collectLinkGraph;
 
-    // All article with the same hash will be recorded in the same bucket of
-    // this hash table.
-    std::map<unsigned int, std::list<zim::entry_index_type>> hash_main;
+    std::vector<WorkerData> workerData;
+
+    // Messages of the completed tasks that cannot be submitted to the
+    // reporter until all the preceding tasks are complete.
+    std::map<size_t, MsgList> pendingMsgs;
+    size_t nextSeqNo = 0;
+    std::mutex msgMutex;
 
     zim::ConcurrentCache<std::string, bool> linkStatusCache;
+
+    // Entry index of the target of the internal links (-1 for a dangling
+    // link), if the link graph is collected
+    zim::ConcurrentCache<std::string, int64_t> linkTargetCache;
+
+    // The internal links found in all the articles, with their resolution
+    static const LinkTable::Target VALID_LINK = -2;
+    static const LinkTable::Target DANGLING_LINK = -1;
+    LinkTable linkTable;
+
+    // Count of the checked entries and of those for which messages were
+    // produced
+    std::atomic<size_t> checkedEntries{0};
+    std::atomic<size_t> failedEntries{0};
+
+    // Count of the clusters found in the cluster cache
+    std::atomic<size_t> cachedClusters{0};
 };
 
-void ArticleChecker::check(zim::Entry entry)
+void ArticleChecker::check(const ClusterTask& task, size_t workerIndex)
+{
+    TaskContext ctx{workerData[workerIndex], MsgList()};
+    if ( profiling )
+        ctx.workerData.profile.queue_wait += std::chrono::steady_clock::now() - task.submitTime;
+
+    Hash128 clusterHash{0, 0};
+    ClusterResult clusterResult;
+    const bool cached = clusterCaching && findCachedResult(task, ctx, clusterHash, clusterResult);
+
+    size_t failedEntryCount = 0;
+    for ( const auto& entry : task.entries ) {
+        const size_t msgCount = ctx.msgs.size();
+        check(entry, ctx);
+        failedEntryCount += ctx.msgs.size() != msgCount;
+    }
+    checkedEntries += task.entries.size();
+    failedEntries += failedEntryCount;
+    if ( ctx.clusterResult )
+        clusterCaching->writer.add(clusterHash, clusterResult.serialize());
+    cachedClusters += cached;
+    submitMsgs(task.seqNo, std::move(ctx.msgs));
+}
+
+// Hashes the cluster of the items of the task (if any) and looks up the
+// results of its checks in the cluster cache. The results are recorded in
+// result, which receives the cached results if they are found.
+bool ArticleChecker::findCachedResult(const ClusterTask& task, TaskContext& ctx,
+                                      Hash128& clusterHash, ClusterResult& result)
+{
+    const auto itemEntry = std::find_if(task.entries.begin(), task.entries.end(),
+                                        [](const zim::Entry& e) { return !e.isRedirect(); });
+    if ( itemEntry == task.entries.end() )
+        return false;
+
+    WorkerData& wd = ctx.workerData;
+    if ( !wd.fileReader )
+        wd.fileReader = std::make_unique<ZimFileReader>(archive.getFilename());
+    const auto cluster = itemEntry->getItem().getClusterIndex();
+    clusterHash = clusterCaching->spans.hash(cluster, *wd.fileReader, wd.clusterData);
+    ctx.clusterResult = &result;
+
+    std::string record;
+    if ( !clusterCaching->cache.find(clusterHash, record) )
+        return false;
+    try {
+        result = ClusterResult::deserialize(record);
+    } catch (const std::runtime_error&) {
+        result = ClusterResult();
+        return false;
+    }
+    return true;
+}
+
+ArticleCheckProfile ArticleChecker::profile() const
+{
+    ArticleCheckProfile result;
+    for ( const auto& wd : workerData )
+        result += wd.profile;
+    return result;
+}
+
+LinkGraph ArticleChecker::linkGraph() const
+{
+    std::vector<const LinkGraph::Part*> parts;
+    for ( const auto& wd : workerData )
+        parts.push_back(&wd.linkGraph);
+    return LinkGraph(archive.getAllEntryCount(), parts);
+}
+
+std::vector<zim::entry_index_type> ArticleChecker::pages() const
+{
+    std::vector<zim::entry_index_type> result;
+    for ( const auto& wd : workerData )
+        result.insert(result.end(), wd.pages.begin(), wd.pages.end());
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void ArticleChecker::submitMsgs(size_t seqNo, MsgList&& msgs)
+{
+    std::lock_guard<std::mutex> lock(msgMutex);
+    pendingMsgs[seqNo] = std::move(msgs);
+    for ( auto it = pendingMsgs.begin(); it != pendingMsgs.end() && it->first == nextSeqNo; ) {
+        for ( const auto& msg : it->second )
+            reporter.addMsg(msg.msgId, msg.msgParams);
+        it = pendingMsgs.erase(it);
+        ++nextSeqNo;
+    }
+}
+
+void ArticleChecker::check(zim::Entry entry, TaskContext& ctx)
 {
     progress.report();
 
     const auto path = entry.getPath();
     const char ns = archive.hasNewNamespaceScheme() ? 'C' : path[0];
 
+    if ( collectLinkGraph && entry.isRedirect() ) {
+        auto& targets = ctx.workerData.linkTargets;
+        targets.assign(1, entry.getRedirectEntryIndex());
+        ctx.workerData.linkGraph.add(entry.getIndex(), targets);
+    }
+
     if (entry.isRedirect() || ns == 'M') {
         return;
     }
 
-    check_item(entry.getItem());
+    if ( collectLinkGraph && (ns == 'C' || ns == 'A') && entry.getItem().getMimetype() == "text/html" )
+        ctx.workerData.pages.push_back(entry.getIndex());
+
+    check_item(entry.getItem(), ctx);
 }
 
-void ArticleChecker::check_item(const zim::Item& item)
+void ArticleChecker::check_item(const zim::Item& item, TaskContext& ctx)
 {
-    if (item.getSize() == 0) {
+    const bool isHtml = item.getMimetype() == "text/html";
+    const bool needsHash = checks.isEnabled(TestType::REDUNDANT);
+    const bool needsLinks = isHtml && (checks.isEnabled(TestType::URL_INTERNAL) ||
+                                       checks.isEnabled(TestType::URL_EXTERNAL));
+
+    // The data of the item needed by the checks are taken from the cluster
+    // cache if they are there. Otherwise they are extracted from the content
+    // of the item (and recorded if the cluster cache is used).
+    ClusterResult::Blob uncachedBlob;
+    ClusterResult::Blob& blob = ctx.clusterResult
+                              ? ctx.clusterResult->blob(item.getBlobIndex())
+                              : uncachedBlob;
+    ArticleChecker::LinkCollection& links = ctx.workerData.links;
+    links.clear();
+    std::string data;
+    if ( blob.checked && (blob.size == 0 || ((!needsHash || blob.hashed) &&
+                                             (!needsLinks || blob.scanned))) ) {
+        if ( needsLinks ) {
+            for ( const auto& l : blob.links )
+                links.add(l.first, l.second);
+        }
+    } else {
+        blob.checked = true;
+        blob.size = item.getSize();
+        ArticleCheckProfile& profile = ctx.workerData.profile;
+        if ( blob.size != 0 && (needsHash || needsLinks) ) {
+            const auto t = timer(ctx, &ArticleCheckProfile::decompression);
+            data = item.getData();
+            profile.read_bytes += data.size();
+            progress.addBytes(data.size());
+        }
+        if ( blob.size != 0 && needsHash ) {
+            const auto t = timer(ctx, &ArticleCheckProfile::hashing);
+            blob.hash = hash128(data);
+            blob.hashed = true;
+            profile.hashed_bytes += data.size();
+        }
+        if ( blob.size != 0 && needsLinks ) {
+            const auto t = timer(ctx, &ArticleCheckProfile::link_extraction);
+            generic_getLinks(data, links);
+            profile.scanned_bytes += data.size();
+            if ( ctx.clusterResult ) {
+                blob.links.clear();
+                for ( const auto& l : links )
+                    blob.links.emplace_back(std::string(l.attribute), std::string(l.link));
+            }
+            blob.scanned = true;
+        }
+    }
+
+    if (blob.size == 0) {
         if (checks.isEnabled(TestType::EMPTY)) {
             const auto path = item.getPath();
             const char ns = archive.hasNewNamespaceScheme() ? 'C' : path[0];
             if (ns == 'C' || ns=='A' || ns == 'I') {
-                reporter.addMsg(MsgId::EMPTY_ENTRY, {{"path", path}});
+                ctx.addMsg(MsgId::EMPTY_ENTRY, {path});
             }
         }
         return;
     }
 
-    std::string data;
-    if (checks.isEnabled(TestType::REDUNDANT) || item.getMimetype() == "text/html")
-        data = item.getData();
-
-    if(checks.isEnabled(TestType::REDUNDANT))
-        hash_main[adler32(data)].push_back( item.getIndex() );
+    if(needsHash)
+        ctx.workerData.fingerprints.add({
+            blob.size,
+            blob.hash,
+            item.getIndex(),
+            item.getClusterIndex(),
+            item.getBlobIndex()
+        });
 
-    if (item.getMimetype() != "text/html")
+    if (!isHtml)
         return;
 
-    ArticleChecker::LinkCollection links;
-    if (checks.isEnabled(TestType::URL_INTERNAL) ||
-        checks.isEnabled(TestType::URL_EXTERNAL)) {
-        links = generic_getLinks(data);
-    }
-
-    if(checks.isEnabled(TestType::URL_INTERNAL))
-    {
-        check_internal_links(item, links);
-    }
-
-    if (checks.isEnabled(TestType::URL_EXTERNAL))
-    {
-        check_external_links(item, links);
-    }
+    check_links(item, links, ctx);
 }
 
-void ArticleChecker::check_internal_links(zim::Item item, const LinkCollection& links)
+// The links are classified in a single pass, for the internal and the
+// external URL checks
+void ArticleChecker::check_links(zim::Item item, const LinkCollection& links, TaskContext& ctx)
 {
+    const bool checkInternal = checks.isEnabled(TestType::URL_INTERNAL);
+    const bool checkExternal = checks.isEnabled(TestType::URL_EXTERNAL);
     const auto path = item.getPath();
-    auto baseUrl = path;
-    auto pos = baseUrl.find_last_of('/');
-    baseUrl.resize( pos==baseUrl.npos ? 0 : pos );
-
-    ArticleChecker::GroupedLinkCollection groupedLinks;
+    const auto pos = path.find_last_of('/');
+    const std::string_view baseUrl(path.data(), pos==path.npos ? 0 : pos);
+
+    auto& wd = ctx.workerData;
+    ArticleChecker::GroupedLinkCollection& groupedLinks = wd.groupedLinks;
+    groupedLinks.clear();
+    wd.normalizedLinks.clear();
+    auto normalizationTimer = timer(ctx, &ArticleCheckProfile::link_normalization);
     int nremptylinks = 0;
+    const html_link* externalResource = nullptr;
     for (const auto &l : links)
     {
-        if (l.link.empty())
-        {
+        switch ( l.classify(baseUrl) ) {
+        case LinkClass::EMPTY:
             nremptylinks++;
-            continue;
+            break;
+
+        case LinkClass::OUT_OF_BOUNDS:
+            if (checkInternal)
+                ctx.addMsg(MsgId::OUTOFBOUNDS_LINK, {std::string(l.link), path});
+            break;
+
+        case LinkClass::INTERNAL:
+            if (checkInternal) {
+                normalize_link(l.link, baseUrl, wd.normalizedLink);
+                groupedLinks.push_back({wd.normalizedLinks.size(), wd.normalizedLink.size(), l.link});
+                wd.normalizedLinks += wd.normalizedLink;
+            }
+            break;
+
+        case LinkClass::EXTERNAL_RESOURCE:
+            if (!externalResource)
+                externalResource = &l;
+            break;
+
+        default:
+            break;
         }
-        if (l.link.front() == '#' || l.link.front() == '?') continue;
-        if (l.isInternalUrl() == false) continue;
+    }
 
+    const std::string_view normalizedLinks(wd.normalizedLinks);
+    const auto normalized = [normalizedLinks](const NormalizedLink& l) {
+        return normalizedLinks.substr(l.offset, l.size);
+    };
+    std::stable_sort(groupedLinks.begin(), groupedLinks.end(),
+        [&normalized](const NormalizedLink& a, const NormalizedLink& b) {
+            return normalized(a) < normalized(b);
+        });
+    normalizationTimer.stop();
 
-        if (isOutofBounds(l.link, baseUrl))
+    if (checkInternal)
+    {
+        if (nremptylinks)
         {
-            reporter.addMsg(MsgId::OUTOFBOUNDS_LINK, {{"link", l.link}, {"path", path}});
-            continue;
+            ctx.addMsg(MsgId::EMPTY_LINKS, {toStr(nremptylinks), path});
         }
 
-        auto normalized = normalize_link(l.link, baseUrl);
-        groupedLinks[normalized].push_back(l.link);
+        check_internal_links(item, groupedLinks, ctx);
     }
 
-    if (nremptylinks)
+    // Only the first external dependence is reported
+    if (checkExternal && externalResource)
     {
-        reporter.addMsg(MsgId::EMPTY_LINKS, {{"count", toStr(nremptylinks)}, {"path", path}});
+        ctx.addMsg(MsgId::EXTERNAL_LINK, {std::string(externalResource->link), path});
     }
-
-    check_internal_links(item, groupedLinks);
 }
 
-void ArticleChecker::check_internal_links(zim::Item item, const GroupedLinkCollection& groupedLinks)
+void ArticleChecker::check_internal_links(zim::Item item, const GroupedLinkCollection& groupedLinks, TaskContext& ctx)
 {
-    const auto path = item.getPath();
-    for(const auto &p: groupedLinks)
-    {
-        const std::string link = p.first;
-        if (!is_valid_internal_link(link)) {
-            kainjow::mustache::list links;
-            for (const auto &olink : p.second)
-                links.push_back({"value", olink});
-            reporter.addMsg(MsgId::DANGLING_LINKS, {{"path", path}, {"normalized_link", link}, {"links", links}});
-            break;
+    const std::string_view normalizedLinks(ctx.workerData.normalizedLinks);
+    std::string& link = ctx.workerData.normalizedLink;
+    // Only the first dangling link is reported, while the targets of all
+    // the links are needed by the link graph
+    bool dangling = false;
+    ctx.workerData.linkTargets.clear();
+    for ( auto it = groupedLinks.begin(); it != groupedLinks.end(); )
+    {
+        const auto normalized = normalizedLinks.substr(it->offset, it->size);
+        auto groupEnd = it + 1;
+        while ( groupEnd != groupedLinks.end()
+             && normalizedLinks.substr(groupEnd->offset, groupEnd->size) == normalized )
+            ++groupEnd;
+
+        link.assign(normalized.data(), normalized.size());
+        auto lookupTimer = timer(ctx, &ArticleCheckProfile::link_lookup);
+        const bool valid = check_internal_link(link, ctx);
+        lookupTimer.stop();
+        if (!valid && !dangling) {
+            MsgParams::List links;
+            for ( ; it != groupEnd; ++it )
+                links.push_back(std::string(it->link));
+            ctx.addMsg(MsgId::DANGLING_LINKS, MsgParams({item.getPath(), link}, std::move(links)));
+            dangling = true;
+            if ( !collectLinkGraph )
+                break;
         }
+        it = groupEnd;
     }
+
+    if ( collectLinkGraph )
+        ctx.workerData.linkGraph.add(item.getIndex(), ctx.workerData.linkTargets);
 }
 
-void ArticleChecker::check_external_links(zim::Item item, const LinkCollection& links)
+void ArticleChecker::detect_redundant_articles()
 {
-    const auto path = item.getPath();
-    for (const auto &l: links)
+    reporter.infoMsg("[INFO] Searching for redundant articles...");
+    reporter.infoMsg("  Verifying Similar Articles for redundancies...");
+    assert(pendingMsgs.empty());
+
+    // Merge the fingerprints collected (and possibly spilled to disk) by
+    // the worker threads. Sorting them puts items with the same content next
+    // to each other, ordered by entry index, so that the result doesn't
+    // depend on the distribution of tasks between the threads.
+    std::vector<SortedRuns<ItemFingerprint>*> sources;
+    size_t fingerprintCount = 0;
+    size_t spilledRunCount = 0;
+    for ( auto& wd : workerData ) {
+        sources.push_back(&wd.fingerprints);
+        fingerprintCount += wd.fingerprints.size();
+        spilledRunCount += wd.fingerprints.spilledRunCount();
+    }
+    if ( spilledRunCount != 0 ) {
+        reporter.infoMsg("  Fingerprints of " + toStr(fingerprintCount) + " items merged from "
+                         + toStr(spilledRunCount) + " sorted runs on disk");
+    }
+
     {
-        if (l.attribute == "src" && l.isExternalUrl())
-        {
-            reporter.addMsg(MsgId::EXTERNAL_LINK, {{"link", l.link}, {"path", path}});
-            break;
+        SortedRunMerger<ItemFingerprint> fingerprints(sources);
+        progress.reset(fingerprintCount, "redundancy");
+        std::vector<ItemFingerprint> group;
+        ItemFingerprint fingerprint;
+        bool more = fingerprints.next(fingerprint);
+        while ( more ) {
+            group.assign(1, fingerprint);
+            while ( (more = fingerprints.next(fingerprint)) && fingerprint.sameContentAs(group.front()) )
+                group.push_back(fingerprint);
+
+            if ( verifyRedundant )
+                verify_redundant_items(group.begin(), group.end());
+            else
+                report_redundant_items(group.begin(), group.end());
+
+            for ( size_t i = 0; i < group.size(); ++i )
+                progress.report();
         }
+        progress.finish();
     }
+
+    for ( auto& wd : workerData )
+        wd.fingerprints = SortedRuns<ItemFingerprint>();
 }
 
-void ArticleChecker::detect_redundant_articles()
+// Items in [begin, end) have the same size and fingerprint, they are
+// considered identical.
+template<class Iter>
+void ArticleChecker::report_redundant_items(Iter begin, Iter end)
 {
-    reporter.infoMsg("[INFO] Searching for redundant articles...");
-    reporter.infoMsg("  Verifying Similar Articles for redundancies...");
-    std::ostringstream output_details;
-    progress.reset(hash_main.size());
-    for(const auto &it: hash_main)
-    {
-        progress.report();
-        auto l = it.second;
-        while ( !l.empty() ) {
-            // The way we have constructed `l`, e1 MUST BE an item
-            const auto e1 = archive.getEntryByPath(l.front()).getItem();
-            l.pop_front();
-            if ( !l.empty() ) {
-                std::unique_ptr<std::string> s1;
-                decltype(l) articlesDifferentFromE1;
-                for(auto other : l) {
-                    // The way we have constructed `l`, e2 MUST BE an item
-                    const auto e2 = archive.getEntryByPath(other).getItem();
-                    if (areAliases(e1, e2)) {
-                        continue;
-                    }
-                    if (!s1) {
-                        s1 = std::make_unique<std::string>(e1.getData());
-                    }
-                    std::string s2 = e2.getData();
-                    if (*s1 != s2 ) {
-                        articlesDifferentFromE1.push_back(other);
-                        continue;
-                    }
-
-                    reporter.addMsg(MsgId::REDUNDANT_ITEMS, {{"path1", e1.getPath()}, {"path2", e2.getPath()}});
+    std::string path1;
+    for ( auto it = begin + 1; it < end; ++it ) {
+        if ( it->isAliasOf(*begin) )
+            continue;
+
+        if ( path1.empty() )
+            path1 = archive.getEntryByPath(begin->index).getPath();
+        const auto path2 = archive.getEntryByPath(it->index).getPath();
+        reporter.addMsg(MsgId::REDUNDANT_ITEMS, {path1, path2});
+    }
+}
+
+// Items in [begin, end) have the same size and fingerprint, their content is
+// compared byte by byte.
+template<class Iter>
+void ArticleChecker::verify_redundant_items(Iter begin, Iter end)
+{
+    std::list<zim::entry_index_type> l;
+    for ( auto it = begin; it < end; ++it )
+        l.push_back(it->index);
+
+    while ( !l.empty() ) {
+        // The way we have constructed `l`, e1 MUST BE an item
+        const auto e1 = archive.getEntryByPath(l.front()).getItem();
+        l.pop_front();
+        if ( !l.empty() ) {
+            std::unique_ptr<std::string> s1;
+            decltype(l) articlesDifferentFromE1;
+            for(auto other : l) {
+                // The way we have constructed `l`, e2 MUST BE an item
+                const auto e2 = archive.getEntryByPath(other).getItem();
+                if (areAliases(e1, e2)) {
+                    continue;
                 }
-                l.swap(articlesDifferentFromE1);
+                if (!s1) {
+                    s1 = std::make_unique<std::string>(e1.getData());
+                }
+                std::string s2 = e2.getData();
+                if (*s1 != s2 ) {
+                    articlesDifferentFromE1.push_back(other);
+                    continue;
+                }
+
+                reporter.addMsg(MsgId::REDUNDANT_ITEMS, {e1.getPath(), e2.getPath()});
             }
+            l.swap(articlesDifferentFromE1);
         }
     }
 }
 
-class TaskStream
+zim::cluster_index_type getClusterIndexOfZimEntry(zim::Entry e)
+{
+    return e.isRedirect() ? 0 : e.getItem().getClusterIndex();
+}
+
+// Feeds the article checks of one ZIM file into a (possibly shared)
+// WorkerPool.
+//
+// Entries are grouped by cluster and each group is submitted as one task.
+// The producer is throttled on the count of tasks of this file that are
+// submitted but not yet completed, so that a big file doesn't flood the
+// queues of a pool shared with other files.
+class TaskDispatcher
 {
 public: // constants
-    const static size_t MAX_SIZE = 1000;
+    const static size_t MAX_QUEUED_TASKS_PER_THREAD = 16;
 
 public: // functions
-    explicit TaskStream(ArticleChecker* ac)
+    // The tasks still queued once *cancellation is true (if set) are
+    // skipped
+    TaskDispatcher(ArticleChecker* ac, WorkerPool& pool, const std::atomic<bool>* _cancellation = nullptr)
         : articleChecker(*ac)
-        , expectingMoreTasks(true)
+        , workerPool(pool)
+        , cancellation(_cancellation)
+        , maxPendingTaskCount(MAX_QUEUED_TASKS_PER_THREAD * pool.size())
     {
-        thread = std::thread([this]() { this->processTasks(); });
     }
 
-    ~TaskStream()
+    ~TaskDispatcher()
     {
-        finish();
-    }
-
-    // Wait for all tasks to complete and terminate the worker thread.
-    // The TaskStream object becomes unusable after call to finish().
-    void finish()
-    {
-        noMoreTasks();
-        if ( thread.joinable()) {
-          thread.join();
-        }
+        waitForPendingTasks();
     }
 
     void addTask(zim::Entry entry)
     {
-        assert(expectingMoreTasks);
-        std::unique_lock<std::mutex> lock(mutex);
-
-        while ( inIsBlocked() )
-            waitUntilInIsUnblocked(lock);
-
-        taskQueue.push(entry);
-        unblockOut();
+        // Assuming that the entries are passed in in cluster order
+        // (which is currently the case for zim::Archive::iterEfficient())
+        const auto entryCluster = getClusterIndexOfZimEntry(entry);
+        if ( !currentTask.entries.empty() && currentCluster != entryCluster )
+            submitCurrentTask();
+        currentCluster = entryCluster;
+        currentTask.entries.push_back(entry);
     }
 
-    void noMoreTasks()
+    // Wait for all tasks to complete. The exception thrown by a failed task
+    // (if any) is rethrown.
+    // The TaskDispatcher object becomes unusable after call to finish().
+    void finish()
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        expectingMoreTasks = false;
-        unblockOut();
+        if ( !currentTask.entries.empty() )
+            submitCurrentTask();
+
+        waitForPendingTasks();
+        if ( error )
+            std::rethrow_exception(error);
     }
 
-private: // types
-    typedef std::shared_ptr<zim::Entry> Task;
+    // Time spent by the producer waiting for room in the queues
+    ArticleCheckProfile::Duration producerWaitTime() const { return waitTime; }
 
 private: // functions
-    void processTasks()
+    void submitCurrentTask()
     {
-        while ( true )
         {
-            const auto t = getNextTask();
-            if ( !t )
-                break;
-            articleChecker.check(*t);
+            std::unique_lock<std::mutex> lock(mutex);
+            if ( pendingTaskCount >= maxPendingTaskCount ) {
+                const auto start = std::chrono::steady_clock::now();
+                cv.wait(lock, [this]() {
+                    return pendingTaskCount < maxPendingTaskCount;
+                });
+                waitTime += std::chrono::steady_clock::now() - start;
+            }
+            ++pendingTaskCount;
         }
-    }
 
-    bool inIsBlocked() const
-    {
-        return taskQueue.size() >= MAX_SIZE;
+        currentTask.seqNo = nextSeqNo++;
+        currentTask.submitTime = std::chrono::steady_clock::now();
+        workerPool.submit([this, task = std::move(currentTask)](size_t workerIndex) {
+            this->runTask(task, workerIndex);
+        });
+        currentTask = ClusterTask();
     }
 
-    bool outIsBlocked() const
+    void runTask(const ClusterTask& task, size_t workerIndex)
     {
-        return expectingMoreTasks && taskQueue.empty();
+        std::exception_ptr taskError;
+        try {
+            if ( cancellation && *cancellation )
+                articleChecker.skip(task);
+            else
+                articleChecker.check(task, workerIndex);
+        } catch (...) {
+            taskError = std::current_exception();
+        }
+
+        // The notification is sent under the lock since the dispatcher
+        // may be destroyed as soon as the last task is seen completed.
+        std::lock_guard<std::mutex> lock(mutex);
+        if ( taskError && !error )
+            error = taskError;
+        --pendingTaskCount;
+        cv.notify_all();
     }
 
-    void waitUntilInIsUnblocked(std::unique_lock<std::mutex>& lock)
+    void waitForPendingTasks()
     {
-        cv.wait(lock);
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]() { return pendingTaskCount == 0; });
     }
 
-    void waitUntilOutIsUnblocked(std::unique_lock<std::mutex>& lock)
+private: // data
+    ArticleChecker& articleChecker;
+    WorkerPool& workerPool;
+    const std::atomic<bool>* const cancellation;
+
+    // Accessed only by the producer
+    ClusterTask currentTask;
+    zim::cluster_index_type currentCluster = 0;
+    size_t nextSeqNo = 0;
+    ArticleCheckProfile::Duration waitTime{0};
+
+    // The count of submitted but not yet completed tasks and the first error
+    // are protected by mutex. Both the throttled producer and finish() wait
+    // on cv.
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t pendingTaskCount = 0;
+    const size_t maxPendingTaskCount;
+    std::exception_ptr error;
+};
+
+// The entries of a ZIM file grouped by cluster, in the order of
+// zim::Archive::iterEfficient(), from which a random sample of the groups
+// can be taken.
+class ClusterGroups
+{
+public: // functions
+    explicit ClusterGroups(const zim::Archive& archive)
     {
-        cv.wait(lock);
+        zim::cluster_index_type currentCluster = 0;
+        for (auto& entry:archive.iterEfficient()) {
+            const auto entryCluster = getClusterIndexOfZimEntry(entry);
+            if ( entryIndices.empty() || currentCluster != entryCluster )
+                groupOffsets.push_back(entryIndices.size());
+            currentCluster = entryCluster;
+            entryIndices.push_back(entry.getIndex());
+        }
+        groupOffsets.push_back(entryIndices.size());
     }
 
-    void unblockIn()
+    size_t size() const { return groupOffsets.size() - 1; }
+
+    size_t entryCount(size_t group) const
     {
-        cv.notify_one();
+        return groupOffsets[group + 1] - groupOffsets[group];
     }
 
-    void unblockOut()
+    template<class F>
+    void forEachEntry(size_t group, F f) const
     {
-        cv.notify_one();
+        for ( size_t i = groupOffsets[group]; i < groupOffsets[group + 1]; ++i )
+            f(entryIndices[i]);
     }
 
-    Task getNextTask()
+    // Picks (at least one) group out of 1/fraction at random, the random
+    // generator being seeded with the given value. The picked groups are
+    // returned in random order.
+    std::vector<size_t> sample(double fraction, size_t seed) const
     {
-        std::unique_lock<std::mutex> lock(mutex);
-        if ( outIsBlocked() )
-            waitUntilOutIsUnblocked(lock);
-
-        Task t;
-        if ( !taskQueue.empty() )
-        {
-            t = std::make_shared<zim::Entry>(taskQueue.front());
-            taskQueue.pop();
-            unblockIn();
-        }
-        return t;
+        std::vector<size_t> groups(size());
+        for ( size_t i = 0; i < groups.size(); ++i )
+            groups[i] = i;
+        std::mt19937_64 rng(seed);
+        std::shuffle(groups.begin(), groups.end(), rng);
+
+        const size_t sampleSize = std::ceil(fraction * groups.size());
+        groups.resize(std::min(groups.size(), std::max<size_t>(sampleSize, 1)));
+        return groups;
     }
 
 private: // data
-    ArticleChecker& articleChecker;
-    std::queue<zim::Entry> taskQueue;
-    std::mutex mutex;
-    std::thread thread;
-
-    // cv is used for managing the blocking & unblocking of both ends of the
-    // task queue. This is possible with a single std::condition_variable due
-    // to the fact that both ends of the queue cannot be blocked at the same
-    // time:
-    // 1. when the input is blocked (because the queue is full), the consumer
-    //    is free to proceed (thus unblocking the input).
-    // 2. when the output is blocked (becuase the queue is empty while more data
-    //    has been promised) the producer is welcome to use the input end.
-    // Thus only the consumer or the producer waits on cv.
-    std::condition_variable cv;
+    std::vector<zim::entry_index_type> entryIndices;
 
-    std::atomic<bool> expectingMoreTasks;
+    // Offset in entryIndices of the first entry of every group, followed by
+    // the count of entries
+    std::vector<size_t> groupOffsets;
 };
 
+// Submits the entries of a random sample of the clusters, for as long as the
+// time budget allows.
+ArticleCheckStats dispatchSample(const zim::Archive& archive, ProgressBar& progress,
+                                 const ArticleCheckOptions& options, TaskDispatcher& td)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    const ClusterGroups clusterGroups(archive);
+
+    // The sample is the same for every check of a given file
+    const size_t seed = std::hash<std::string>()(toStr(archive.getUuid()));
+    auto sample = clusterGroups.sample(options.sample_fraction, seed);
+
+    // Without time limit, the sampled clusters are checked in the order of
+    // the file
+    if ( options.time_budget <= 0 )
+        std::sort(sample.begin(), sample.end());
+
+    size_t sampleEntryCount = 0;
+    for ( const size_t group : sample )
+        sampleEntryCount += clusterGroups.entryCount(group);
+    progress.reset(sampleEntryCount, "articles");
+
+    const auto deadline = startTime + std::chrono::duration<double>(options.time_budget);
+    ArticleCheckStats stats;
+    stats.cluster_count = clusterGroups.size();
+    stats.entry_count = archive.getEntryCount();
+    for ( const size_t group : sample ) {
+        if ( options.time_budget > 0 && std::chrono::steady_clock::now() >= deadline )
+            break;
+        if ( options.cancelled() )
+            break;
+        clusterGroups.forEachEntry(group, [&](zim::entry_index_type i) {
+            td.addTask(archive.getEntryByPath(i));
+        });
+        ++stats.checked_cluster_count;
+    }
+    return stats;
+}
 
-zim::cluster_index_type getClusterIndexOfZimEntry(zim::Entry e)
+std::unique_ptr<PathIndex> buildPathIndex(const zim::Archive& archive, ErrorLogger& reporter,
+                                          const ArticleCheckOptions& options, WorkerPool& workerPool)
 {
-    return e.isRedirect() ? 0 : e.getItem().getClusterIndex();
+    const size_t memoryUsage = PathIndex::memoryUsage(archive.getEntryCount());
+    const size_t MB = 1024 * 1024;
+    if ( memoryUsage > options.path_index_max_mb * MB ) {
+        reporter.infoMsg("  Index of entry paths not built: it needs "
+                         + toStr((memoryUsage + MB - 1) / MB) + " MB (limit is "
+                         + toStr(options.path_index_max_mb) + " MB)");
+        return nullptr;
+    }
+
+    auto pathIndex = std::make_unique<PathIndex>(archive, workerPool);
+    reporter.infoMsg("  Index of entry paths: " + toStr(pathIndex->size())
+                     + " entries, " + toStr((memoryUsage + 1023) / 1024) + " KB");
+    return pathIndex;
 }
 
-class TaskDispatcher
+// Writes the graph of the internal links collected by the article checker
+// and analyses it
+LinkGraphReport writeLinkGraph(const zim::Archive& archive, ErrorLogger& reporter,
+                               const ArticleChecker& articleChecker,
+                               const std::string& path, WorkerPool& workerPool)
 {
-public: // functions
-    explicit TaskDispatcher(ArticleChecker* ac, unsigned n)
-        : currentCluster(-1)
-    {
-        while ( n-- )
-            taskStreams.emplace_back(ac);
+    const LinkGraph graph = articleChecker.linkGraph();
+    graph.write(path);
+
+    LinkGraphReport report;
+    report.node_count = graph.nodeCount();
+    report.link_count = graph.linkCount();
+    const auto pages = articleChecker.pages();
+    report.page_count = pages.size();
+
+    // The main entry is outside of the content namespace (thus not in the
+    // graph), the search starts from the item it redirects to
+    report.has_main_page = archive.hasMainEntry();
+    const auto mainPage = report.has_main_page ? archive.getMainEntry().getItem(true).getIndex()
+                                               : zim::entry_index_type(-1);
+
+    const auto inDegrees = graph.inDegrees();
+    for ( const auto page : pages ) {
+        if ( inDegrees[page] == 0 && page != mainPage )
+            report.orphan_pages.push_back(archive.getEntryByPath(page).getPath());
     }
 
-    void addTask(zim::Entry entry)
-    {
-        // Assuming that the entries are passed in in cluster order
-        // (which is currently the case for zim::Archive::iterEfficient())
-        const auto entryCluster = getClusterIndexOfZimEntry(entry);
-        if ( currentCluster != entryCluster )
-        {
-            taskStreams.splice(taskStreams.end(), taskStreams, taskStreams.begin());
-            currentCluster = entryCluster;
+    if ( report.has_main_page ) {
+        const auto reachable = graph.reachableFrom(mainPage, &workerPool);
+        for ( const auto page : pages ) {
+            if ( !reachable[page] )
+                report.unreachable_pages.push_back(archive.getEntryByPath(page).getPath());
         }
-        taskStreams.begin()->addTask(entry);
     }
 
-    // Wait for all tasks to complete and terminate the worker threads.
-    // The TaskDispatcher object becomes unusable after call to finish().
-    void finish()
-    {
-        taskStreams.clear();
+    reporter.infoMsg("  Link graph: " + toStr(report.link_count) + " links between "
+                     + toStr(report.node_count) + " entries written to " + path);
+    reporter.infoMsg("  Orphan pages: " + toStr(report.orphan_pages.size())
+                     + " of " + toStr(report.page_count));
+    if ( report.has_main_page ) {
+        reporter.infoMsg("  Pages unreachable from the main page: "
+                         + toStr(report.unreachable_pages.size()) + " of " + toStr(report.page_count));
+    } else {
+        reporter.infoMsg("  Pages unreachable from the main page: unknown (no main page)");
     }
-
-private: // data
-    std::list<TaskStream> taskStreams;
-    zim::cluster_index_type currentCluster;
-};
+    return report;
+}
 
 } // unnamed namespace
 
-void test_articles(const zim::Archive& archive, ErrorLogger& reporter, ProgressBar& progress,
-                   const EnabledTests checks, int thread_count) {
-    ArticleChecker articleChecker(archive, reporter, progress, checks);
+double ArticleCheckStats::coverage() const
+{
+    return entry_count ? double(checked_entry_count) / entry_count : 1.0;
+}
+
+double ArticleCheckStats::error_rate() const
+{
+    return checked_entry_count ? double(failed_entry_count) / checked_entry_count : 0.0;
+}
+
+JSON::OutputStream& operator<<(JSON::OutputStream& out, const LinkGraphReport& report)
+{
+    out << JSON::startObject;
+    out << JSON::property("node_count", report.node_count);
+    out << JSON::property("link_count", report.link_count);
+    out << JSON::property("page_count", report.page_count);
+    out << JSON::property("orphan_pages", JSON::startArray);
+    for ( const auto& path : report.orphan_pages )
+        out << path;
+    out << JSON::endArray;
+    if ( report.has_main_page ) {
+        out << JSON::property("unreachable_pages", JSON::startArray);
+        for ( const auto& path : report.unreachable_pages )
+            out << path;
+        out << JSON::endArray;
+    }
+    out << JSON::endObject;
+    return out;
+}
+
+JSON::OutputStream& operator<<(JSON::OutputStream& out, const ArticleCheckStats& stats)
+{
+    out << JSON::startObject;
+    out << JSON::property("cluster_count", stats.cluster_count);
+    out << JSON::property("checked_cluster_count", stats.checked_cluster_count);
+    out << JSON::property("entry_count", stats.entry_count);
+    out << JSON::property("checked_entry_count", stats.checked_entry_count);
+    out << JSON::property("failed_entry_count", stats.failed_entry_count);
+    out << JSON::property("coverage", stats.coverage());
+    out << JSON::property("error_rate", stats.error_rate());
+    out << JSON::endObject;
+    return out;
+}
+
+ArticleCheckProfile& ArticleCheckProfile::operator+=(const ArticleCheckProfile& other)
+{
+    path_index += other.path_index;
+    redundancy += other.redundancy;
+    decompression += other.decompression;
+    hashing += other.hashing;
+    link_extraction += other.link_extraction;
+    link_normalization += other.link_normalization;
+    link_lookup += other.link_lookup;
+    queue_wait += other.queue_wait;
+    dispatch_wait += other.dispatch_wait;
+    read_bytes += other.read_bytes;
+    hashed_bytes += other.hashed_bytes;
+    scanned_bytes += other.scanned_bytes;
+    link_lookups += other.link_lookups;
+    path_index_hits += other.path_index_hits;
+    link_cache_hits += other.link_cache_hits;
+    link_cache_misses += other.link_cache_misses;
+    distinct_links += other.distinct_links;
+    return *this;
+}
+
+JSON::OutputStream& operator<<(JSON::OutputStream& out, const ArticleCheckProfile& profile)
+{
+    const auto seconds = [](ArticleCheckProfile::Duration d) {
+        return std::chrono::duration<double>(d).count();
+    };
+    out << JSON::startObject;
+    out << JSON::property("path_index_seconds", seconds(profile.path_index));
+    out << JSON::property("redundancy_seconds", seconds(profile.redundancy));
+    out << JSON::property("decompression_seconds", seconds(profile.decompression));
+    out << JSON::property("hashing_seconds", seconds(profile.hashing));
+    out << JSON::property("link_extraction_seconds", seconds(profile.link_extraction));
+    out << JSON::property("link_normalization_seconds", seconds(profile.link_normalization));
+    out << JSON::property("link_lookup_seconds", seconds(profile.link_lookup));
+    out << JSON::property("queue_wait_seconds", seconds(profile.queue_wait));
+    out << JSON::property("dispatch_wait_seconds", seconds(profile.dispatch_wait));
+    out << JSON::property("read_bytes", profile.read_bytes);
+    out << JSON::property("hashed_bytes", profile.hashed_bytes);
+    out << JSON::property("scanned_bytes", profile.scanned_bytes);
+    out << JSON::property("link_lookups", profile.link_lookups);
+    out << JSON::property("path_index_hits", profile.path_index_hits);
+    out << JSON::property("link_cache_hits", profile.link_cache_hits);
+    out << JSON::property("link_cache_misses", profile.link_cache_misses);
+    out << JSON::property("distinct_links", profile.distinct_links);
+    out << JSON::endObject;
+    return out;
+}
+
+ArticleCheckStats test_articles(const zim::Archive& archive, ErrorLogger& reporter, ProgressBar& progress,
+                   const EnabledTests checks, const ArticleCheckOptions& _options) {
+    // Shares of the memory budget: a quarter for the index of entry paths,
+    // an eighth for the table of links and a quarter for the fingerprints
+    ArticleCheckOptions options(_options);
+    const size_t MB = 1024 * 1024;
+    size_t fingerprintMaxMemory = SIZE_MAX;
+    if ( options.max_memory_mb != 0 ) {
+        options.path_index_max_mb = std::min(options.path_index_max_mb, options.max_memory_mb / 4);
+        options.link_table_max_mb = std::min(options.link_table_max_mb, options.max_memory_mb / 8);
+        fingerprintMaxMemory = options.max_memory_mb * MB / 4;
+    }
+
+    std::unique_ptr<WorkerPool> ownWorkerPool;
+    if ( !options.worker_pool )
+        ownWorkerPool = std::make_unique<WorkerPool>(std::max(options.thread_count, 1));
+    WorkerPool& workerPool = options.worker_pool ? *options.worker_pool : *ownWorkerPool;
+    const unsigned threadCount = workerPool.size();
     reporter.infoMsg("[INFO] Verifying Articles' content...");
 
-    TaskDispatcher td(&articleChecker, thread_count);
-    for (auto& entry:archive.iterEfficient()) {
-        td.addTask(entry);
+    const bool collectLinkGraph = ArticleChecker::collectsLinkGraph(options, checks);
+
+    ArticleCheckProfile::Duration pathIndexTime{0};
+    std::unique_ptr<PathIndex> pathIndex;
+    if ( checks.isEnabled(TestType::URL_INTERNAL) && !collectLinkGraph ) {
+        ScopedTimer timer(options.profile ? &pathIndexTime : nullptr);
+        pathIndex = buildPathIndex(archive, reporter, options, workerPool);
+    }
+
+    std::unique_ptr<ClusterCache> clusterCache;
+    std::unique_ptr<ClusterCacheWriter> clusterCacheWriter;
+    std::unique_ptr<ClusterSpans> clusterSpans;
+    std::unique_ptr<ArticleChecker::ClusterCaching> clusterCaching;
+    if ( !options.cluster_cache.empty() ) {
+        clusterCache = std::make_unique<ClusterCache>(options.cluster_cache);
+        clusterCacheWriter = std::make_unique<ClusterCacheWriter>(options.cluster_cache);
+        clusterSpans = std::make_unique<ClusterSpans>(archive);
+        clusterCaching.reset(new ArticleChecker::ClusterCaching{*clusterSpans, *clusterCache, *clusterCacheWriter});
+    }
+
+    ArticleChecker articleChecker(archive, reporter, progress, checks, options, threadCount,
+                                  pathIndex.get(), clusterCaching.get(), fingerprintMaxMemory);
+
+    ArticleCheckStats stats;
+    TaskDispatcher td(&articleChecker, workerPool, options.cancellation);
+    if ( options.sampled() ) {
+        stats = dispatchSample(archive, progress, options, td);
+    } else {
+        // The workers decompress the clusters in parallel already, the
+        // pipeline only reads ahead the clusters they are about to check
+        ClusterPipeline::Options pipelineOptions;
+        pipelineOptions.helper_threads = 0;
+        pipelineOptions.lookahead = 2 * threadCount;
+        ClusterPipeline pipeline(archive, pipelineOptions);
+        ClusterPipeline::Group group;
+        while ( !options.cancelled() && pipeline.next(group) ) {
+            for ( const auto& entry : group.entries )
+                td.addTask(entry);
+        }
+        stats.entry_count = archive.getEntryCount();
     }
     td.finish();
+    progress.finish();
+    stats.checked_entry_count = articleChecker.checkedEntryCount();
+    stats.failed_entry_count = articleChecker.failedEntryCount();
+    if ( options.profile ) {
+        stats.profile = articleChecker.profile();
+        stats.profile.path_index = pathIndexTime;
+        stats.profile.dispatch_wait = td.producerWaitTime();
+        stats.profile.distinct_links = articleChecker.distinctLinkCount();
+    }
+
+    // The results are incomplete, they are discarded (and the cluster cache
+    // left unchanged)
+    if ( options.cancelled() )
+        return stats;
+
+    if ( clusterCaching ) {
+        // The new cache replaces the old one, which must be closed first
+        const size_t clusterCount = clusterCacheWriter->size();
+        clusterCaching.reset();
+        clusterCache.reset();
+        clusterCacheWriter->commit();
+        reporter.infoMsg("  Cluster cache: " + toStr(articleChecker.cachedClusterCount())
+                         + " of " + toStr(clusterCount) + " clusters found");
+    }
 
     if (checks.isEnabled(TestType::REDUNDANT))
     {
+        ScopedTimer timer(options.profile ? &stats.profile.redundancy : nullptr);
         articleChecker.detect_redundant_articles();
     }
+
+    if ( collectLinkGraph )
+        stats.link_graph = writeLinkGraph(archive, reporter, articleChecker, options.link_graph, workerPool);
+
+    if ( options.sampled() ) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(2);
+        ss << "  Sample: " << stats.checked_cluster_count << " of "
+           << stats.cluster_count << " clusters, " << stats.checked_entry_count
+           << " of " << stats.entry_count << " entries ("
+           << 100 * stats.coverage() << "%)\n";
+        ss << "  Entries with errors: " << stats.failed_entry_count << " ("
+           << 100 * stats.error_rate() << "%), about "
+           << std::llround(stats.error_rate() * stats.entry_count)
+           << " in the whole file";
+        reporter.infoMsg(ss.str());
+    }
+    return stats;
 }
 
 namespace
 {
 
+// Redirection target of every entry (an item redirects to itself) and
+// whether it is inside a redirection loop.
+//
+// Both the construction of the table and the detection of the loops are
+// performed in parallel (on the workers of a pool, if any) over disjoint
+// ranges of entries. The loop status of
+// an entry only depends on the redirections, so concurrent resolutions of
+// the same chain of redirections store the same values.
+//
+// The construction stops early once *cancellation is true (if set), the
+// table being then incomplete.
 class RedirectionTable
 {
 private: // types
@@ -703,37 +2083,75 @@ private: // types
     };
 
 public: // functions
-    explicit RedirectionTable(size_t entryCount)
+    RedirectionTable(const zim::Archive& archive, WorkerPool* _workerPool,
+                     const std::atomic<bool>* _cancellation = nullptr)
+        : redirTable(archive.getEntryCount())
+        , loopStatus(new std::atomic<uint8_t>[redirTable.size()])
+        , workerPool(_workerPool)
+        , cancellation(_cancellation)
     {
-        loopStatus.reserve(entryCount);
-        redirTable.reserve(entryCount);
+        forEachRange([&](size_t begin, size_t end) {
+            for ( size_t i = begin; i < end; ++i ) {
+                const auto entry = archive.getEntryByPath(zim::entry_index_type(i));
+                if ( entry.isRedirect() ) {
+                    redirTable[i] = entry.getRedirectEntryIndex();
+                    setStatus(i, LoopStatus::UNKNOWN);
+                } else {
+                    redirTable[i] = zim::entry_index_type(i);
+                    setStatus(i, LoopStatus::NONLOOP);
+                }
+            }
+        });
+
+        if ( cancelled() )
+            return;
+
+        forEachRange([&](size_t begin, size_t end) {
+            for ( size_t i = begin; i < end; ++i ) {
+                if ( status(i) == LoopStatus::UNKNOWN )
+                    resolveLoopStatus(zim::entry_index_type(i));
+            }
+        });
     }
 
-    void addRedirectionEntry(zim::entry_index_type targetEntryIndex)
+    size_t size() const { return redirTable.size(); }
+
+    bool cancelled() const { return cancellation && *cancellation; }
+
+    bool isInRedirectionLoop(zim::entry_index_type i) const
     {
-        redirTable.push_back(targetEntryIndex);
-        loopStatus.push_back(LoopStatus::UNKNOWN);
+        return status(i) == LOOP;
     }
 
-    void addItem()
+private: // functions
+    // Calls f() on ranges of 4096 entries (the cancellation being checked
+    // before each of them)
+    template<class F>
+    void forEachRange(F f) const
     {
-        redirTable.push_back(redirTable.size());
-        loopStatus.push_back(LoopStatus::NONLOOP);
+        const size_t CHUNK_SIZE = 4096;
+        const auto g = [this, &f](size_t begin, size_t end) {
+            if ( !cancelled() )
+                f(begin, end);
+        };
+        if ( workerPool ) {
+            workerPool->forEachRange(size(), CHUNK_SIZE, g);
+        } else {
+            for ( size_t begin = 0; begin < size(); begin += CHUNK_SIZE )
+                g(begin, std::min(begin + CHUNK_SIZE, size()));
+        }
     }
 
-    size_t size() const { return redirTable.size(); }
-
-    bool isInRedirectionLoop(zim::entry_index_type i)
+    LoopStatus status(zim::entry_index_type i) const
     {
-        if ( loopStatus[i] == UNKNOWN )
-        {
-            resolveLoopStatus(i);
-        }
+        return LoopStatus(loopStatus[i].load(std::memory_order_relaxed));
+    }
 
-        return loopStatus[i] == LOOP;
+    void setStatus(zim::entry_index_type i, LoopStatus s)
+    {
+        loopStatus[i].store(s, std::memory_order_relaxed);
     }
 
-private: // functions
     LoopStatus detectLoopStatus(zim::entry_index_type i) const
     {
         auto i1 = i;
@@ -744,8 +2162,9 @@ private: // functions
         // if i2 runs over i1 then they are both inside a redirection loop
         for (bool moveI1 = false ; ; moveI1 = !moveI1)
         {
-            if ( loopStatus[i2] != LoopStatus::UNKNOWN )
-                return loopStatus[i2];
+            const LoopStatus s = status(i2);
+            if ( s != LoopStatus::UNKNOWN )
+                return s;
 
             i2 = redirTable[i2];
 
@@ -760,36 +2179,33 @@ private: // functions
     void resolveLoopStatus(zim::entry_index_type i)
     {
         const LoopStatus s = detectLoopStatus(i);
-        for ( ; loopStatus[i] == LoopStatus::UNKNOWN; i = redirTable[i] )
+        for ( ; status(i) == LoopStatus::UNKNOWN; i = redirTable[i] )
         {
-            loopStatus[i] = s;
+            setStatus(i, s);
         }
     }
 
 private: // data
     std::vector<zim::entry_index_type> redirTable;
-    std::vector<LoopStatus> loopStatus;
+    std::unique_ptr<std::atomic<uint8_t>[]> loopStatus;
+    WorkerPool* const workerPool;
+    const std::atomic<bool>* const cancellation;
 };
 
 } // unnamed namespace
 
-void test_redirect_loop(const zim::Archive& archive, ErrorLogger& reporter) {
+void test_redirect_loop(const zim::Archive& archive, ErrorLogger& reporter, WorkerPool* workerPool,
+                        const std::atomic<bool>* cancellation) {
     reporter.infoMsg("[INFO] Checking for redirect loops...");
 
-    RedirectionTable redirTable(archive.getAllEntryCount());
-    for(const auto& entry: archive.iterByPath())
-    {
-        if ( entry.isRedirect() )
-            redirTable.addRedirectionEntry(entry.getRedirectEntryIndex());
-        else
-            redirTable.addItem();
-    }
-
+    const RedirectionTable redirTable(archive, workerPool, cancellation);
+    if ( redirTable.cancelled() )
+        return;
     for(zim::entry_index_type i = 0; i < redirTable.size(); ++i )
     {
         if(redirTable.isInRedirectionLoop(i)){
             const auto entry = archive.getEntryByPath(i);
-            reporter.addMsg(MsgId::REDIRECT_LOOP, {{"entry_path", entry.getPath()}});
+            reporter.addMsg(MsgId::REDIRECT_LOOP, {entry.getPath()});
         }
     }
 }
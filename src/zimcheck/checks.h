@@ -2,10 +2,17 @@
 #define _ZIM_TOOL_ZIMFILECHECKS_H_
 
 #include <vector>
+#include <array>
+#include <initializer_list>
 #include <iostream>
 #include <bitset>
-
-#include <mustache.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
 
 #include "json_tools.h"
 #include "../progress.h"
@@ -14,6 +21,8 @@ namespace zim {
   class Archive;
 }
 
+class WorkerPool;
+
 enum StatusCode : int {
    PASS = 0,
    FAIL = 1,
@@ -64,11 +73,40 @@ enum class MsgId
   MISSING_FAVICON
 };
 
-using MsgParams = kainjow::mustache::object;
+// Values of the parameters of a message, in the order in which the
+// parameters are declared for its MsgId in the message table. The last
+// parameter of a message may be a list (e.g. of dangling links).
+class MsgParams
+{
+  public:
+    static const size_t MAX_COUNT = 2;
+    typedef std::vector<std::string> List;
+
+    MsgParams() {}
+    MsgParams(std::initializer_list<std::string> values, List list = List());
+
+    size_t size() const { return count; }
+    const std::string& operator[](size_t i) const { return values[i]; }
+    const List& list() const { return listValue; }
+
+  private:
+    std::array<std::string, MAX_COUNT> values;
+    size_t count = 0;
+    List listValue;
+};
 
 JSON::OutputStream& operator<<(JSON::OutputStream& out, TestType check);
 JSON::OutputStream& operator<<(JSON::OutputStream& out, EnabledTests checks);
 
+enum class OutputFormat
+{
+    TEXT,
+    JSON,           // A JSON document
+    COMPACT_JSON,   // A JSON document on a single line
+    NDJSON          // A JSON object per line for every message (output as
+                    // soon as it is found), then a summary
+};
+
 class ErrorLogger {
   private:
     struct MsgIdWithParams
@@ -78,20 +116,65 @@ class ErrorLogger {
     };
 
     // reportMsgs[i] holds messages for the i'th test/check
+    // (not used in NDJSON format)
     std::vector<std::vector<MsgIdWithParams>> reportMsgs;
 
+    // Once the (approximate) memory used by reportMsgs exceeds the limit,
+    // the messages are moved to temporary files (one per test/check), from
+    // which they are read back by report()
+    size_t msgMemory = 0;
+    size_t msgMemoryLimit = SIZE_MAX;
+    struct FileCloser { void operator()(std::FILE* f) const { std::fclose(f); } };
+    std::vector<std::unique_ptr<std::FILE, FileCloser>> spilledMsgs;
+
     // testStatus[i] corresponds to the status of i'th test
     std::bitset<size_t(TestType::COUNT)> testStatus;
 
+    const OutputFormat format;
+
+    // Name of the checked file, repeated in every message in NDJSON format
+    std::string fileName;
+
+    // Output buffer and messages (in the order of their production) of a
+    // deferred logger, and the logger to which it forwards its messages once
+    // merged
+    std::unique_ptr<std::ostringstream> deferredOutput;
+    std::vector<MsgIdWithParams> deferredMsgs;
+    ErrorLogger* forwardTo = nullptr;
+    mutable std::mutex deferredMutex;
+
+    std::ostream& out;
+    // Output of the summary in NDJSON format
+    std::ostringstream summaryOutput;
     mutable JSON::OutputStream jsonOutputStream;
 
+    explicit ErrorLogger(std::unique_ptr<std::ostringstream> buffer);
+
+    void storeMsg(MsgIdWithParams&& msg);
+    void spillMsgs();
+    template<class F> void forEachMsg(size_t check, F f) const;
+
     static std::string expand(const MsgIdWithParams& msg);
-    void jsonOutput(const MsgIdWithParams& msg) const;
+    void jsonOutput(JSON::OutputStream& stream, const MsgIdWithParams& msg) const;
+    void streamMsg(const MsgIdWithParams& msg) const;
 
   public:
-    explicit ErrorLogger(bool _jsonOutputMode = false);
+    explicit ErrorLogger(OutputFormat format = OutputFormat::TEXT,
+                         std::ostream& out = std::cout);
     ~ErrorLogger();
 
+    // A deferred logger collects the messages of a check running
+    // concurrently with other checks. mergeDeferred() passes them to this
+    // logger (outputting them, if it is the case); the deferred logger then
+    // forwards its next messages directly to this logger.
+    std::unique_ptr<ErrorLogger> makeDeferred() const;
+    void mergeDeferred(ErrorLogger& deferred);
+
+    void setFileName(const std::string& name) { fileName = name; }
+
+    // Limits the memory used by the messages waiting for report()
+    void setMemoryLimit(size_t bytes) { msgMemoryLimit = bytes; }
+
     void infoMsg(const std::string& msg) const;
 
     template<class T>
@@ -109,12 +192,171 @@ class ErrorLogger {
 
 
 void test_checksum(zim::Archive& archive, ErrorLogger& reporter);
-bool test_integrity(const std::string& filename, ErrorLogger& reporter);
+// Same as above, in a single sequential pass over the file
+void test_checksum(const std::string& filename, ErrorLogger& reporter);
+// The integrity checks, split into the validation of the structure of the
+// file and the (much longer) validation of its checksum
+bool test_integrity_structure(const std::string& filename, ErrorLogger& reporter);
+bool test_integrity_checksum(const std::string& filename, ErrorLogger& reporter);
 void test_metadata(const zim::Archive& archive, ErrorLogger& reporter);
 void test_favicon(const zim::Archive& archive, ErrorLogger& reporter);
 void test_mainpage(const zim::Archive& archive, ErrorLogger& reporter);
-void test_articles(const zim::Archive& archive, ErrorLogger& reporter, ProgressBar& progress,
-                   const EnabledTests enabled_tests, int thread_count=1);
-void test_redirect_loop(const zim::Archive& archive, ErrorLogger& reporter);
+// Settings of test_articles()
+struct ArticleCheckOptions
+{
+    int thread_count = 1;
+
+    // Compare byte by byte the items found redundant
+    bool verify_redundant = false;
+
+    // Memory limit (in MB) of the index of entry paths used by the internal
+    // URL check. The index is not used if it doesn't fit.
+    size_t path_index_max_mb = 512;
+
+    // Memory limit (in MB) of the table of the distinct internal links, each
+    // of which is resolved only once. The links that don't fit are resolved
+    // through a cache of limited size.
+    size_t link_table_max_mb = 512;
+
+    // Memory budget (in MB) of the article checks, 0 meaning no limit. The
+    // limits of the index of entry paths and of the table of links are
+    // lowered to fit in the budget, and the fingerprints of the items (for
+    // the redundancy check) are spilled to temporary files beyond their
+    // share of it.
+    size_t max_memory_mb = 0;
+
+    // Pool of threads running the checks (it can be shared by the checks of
+    // several files). If not set, a pool of thread_count threads is used.
+    WorkerPool* worker_pool = nullptr;
+
+    // Fraction of the clusters whose entries are checked. The clusters are
+    // picked at random (the same ones for a given file).
+    double sample_fraction = 1.0;
+
+    // Time limit (in seconds) of the checks, 0 meaning no limit. The sampled
+    // clusters are then checked in random order, so that the part checked
+    // when the time is up is a representative sample.
+    double time_budget = 0;
+
+    bool sampled() const { return sample_fraction < 1.0 || time_budget > 0; }
+
+    // Path of the cache of the results of the checks of the clusters (not
+    // used if empty). The clusters found in the cache are neither
+    // decompressed nor scanned, only their links are checked again.
+    std::string cluster_cache;
+
+    // Collect the counters and timers of ArticleCheckProfile
+    bool profile = false;
+
+    // Path of the file to which the graph of the internal links is written
+    // (see LinkGraph), and from which LinkGraphReport is computed. Not
+    // written if empty. Needs the URL_INTERNAL check.
+    std::string link_graph;
+
+    // If set, the checks stop as soon as possible once it is true (e.g. when
+    // the file is found corrupted by a concurrent check), their results
+    // being incomplete
+    const std::atomic<bool>* cancellation = nullptr;
+
+    bool cancelled() const { return cancellation && *cancellation; }
+};
+
+// Where the time of the article checks goes (collected if
+// ArticleCheckOptions::profile is set). The times of the work done by the
+// worker threads are summed over the threads.
+struct ArticleCheckProfile
+{
+    typedef std::chrono::steady_clock::duration Duration;
+
+    // Construction of the index of entry paths and search for redundant
+    // items (wall-clock time)
+    Duration path_index{0};
+    Duration redundancy{0};
+
+    // Reading (thus decompression) of the content of the items, hashing
+    // of the content, extraction of the links from the HTML items,
+    // classification of the links and normalization of the internal ones,
+    // and lookup of their targets
+    Duration decompression{0};
+    Duration hashing{0};
+    Duration link_extraction{0};
+    Duration link_normalization{0};
+    Duration link_lookup{0};
+
+    // Time spent by the tasks in the queues of the worker pool, and by the
+    // producer of the tasks waiting for room in the queues
+    Duration queue_wait{0};
+    Duration dispatch_wait{0};
+
+    // Bytes of content read, hashed (redundancy check) and scanned for
+    // links (URL checks)
+    uint64_t read_bytes = 0;
+    uint64_t hashed_bytes = 0;
+    uint64_t scanned_bytes = 0;
+
+    // Lookups of internal link targets, answered by the index of entry
+    // paths or by the table (or cache) of links (a miss querying the
+    // archive), and count of distinct links in the table of links
+    size_t link_lookups = 0;
+    size_t path_index_hits = 0;
+    size_t link_cache_hits = 0;
+    size_t link_cache_misses = 0;
+    size_t distinct_links = 0;
+
+    ArticleCheckProfile& operator+=(const ArticleCheckProfile& other);
+};
+
+JSON::OutputStream& operator<<(JSON::OutputStream& out, const ArticleCheckProfile& profile);
+
+// Analysis of the graph of the internal links (see
+// ArticleCheckOptions::link_graph). The pages are the HTML items of the
+// content namespace, listed by path.
+struct LinkGraphReport
+{
+    size_t node_count = 0;
+    size_t link_count = 0;
+    size_t page_count = 0;
+
+    // Pages that no entry links to
+    std::vector<std::string> orphan_pages;
+
+    // Pages that can't be reached by following the links (and the
+    // redirections) from the main page, if there is a main page
+    bool has_main_page = false;
+    std::vector<std::string> unreachable_pages;
+};
+
+JSON::OutputStream& operator<<(JSON::OutputStream& out, const LinkGraphReport& report);
+
+// Coverage of the article checks (all the entries are checked unless the
+// checks are sampled) and count of the checked entries with errors
+struct ArticleCheckStats
+{
+    size_t cluster_count = 0;
+    size_t checked_cluster_count = 0;
+    size_t entry_count = 0;
+    size_t checked_entry_count = 0;
+    size_t failed_entry_count = 0;
+
+    ArticleCheckProfile profile;
+
+    LinkGraphReport link_graph;
+
+    double coverage() const;
+
+    // Fraction of the checked entries with errors, which estimates the
+    // fraction for the whole file if the checked entries are a sample
+    double error_rate() const;
+};
+
+JSON::OutputStream& operator<<(JSON::OutputStream& out, const ArticleCheckStats& stats);
+
+ArticleCheckStats test_articles(const zim::Archive& archive, ErrorLogger& reporter, ProgressBar& progress,
+                   const EnabledTests enabled_tests,
+                   const ArticleCheckOptions& options = ArticleCheckOptions());
+// The redirections are resolved on the workers of the pool (if any). Stops
+// as soon as possible once *cancellation is true (if set).
+void test_redirect_loop(const zim::Archive& archive, ErrorLogger& reporter, WorkerPool* workerPool = nullptr,
+                        const std::atomic<bool>* cancellation = nullptr);
 
 #endif
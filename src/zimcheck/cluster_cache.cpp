@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "cluster_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef VERSION
+  #define VERSION "undefined"
+#endif
+
+// Layout of a cache file (integers are stored in the byte order of the
+// machine, which is checked through the trailer):
+//
+//   header      "zimcheck cluster cache <version>\n"
+//   records     serialized ClusterResult of every cluster
+//   index       (hash.low, hash.high, offset, size) of every record
+//   trailer     count of records, offset of the index, TRAILER_MAGIC
+//
+// The results of the checks may change from one version of zimcheck to the
+// next one, thus a cache is used only by the version that wrote it.
+
+namespace
+{
+
+const std::string HEADER = "zimcheck cluster cache " VERSION "\n";
+const uint64_t TRAILER_MAGIC = 0x31484341434b435aULL;
+const size_t INDEX_ENTRY_SIZE = 4 * sizeof(uint64_t);
+const size_t TRAILER_SIZE = 3 * sizeof(uint64_t);
+
+enum BlobFlags : uint8_t
+{
+    CHECKED = 1,
+    HASHED = 2,
+    SCANNED = 4
+};
+
+template<class T>
+void put(std::string& out, T value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void putString(std::string& out, const std::string& s)
+{
+    put<uint32_t>(out, s.size());
+    out += s;
+}
+
+// Reads the fields of a record, checking that they lie within the record
+class RecordReader
+{
+  public: // functions
+    explicit RecordReader(const std::string& record) : data(record) {}
+
+    template<class T>
+    T get()
+    {
+        T value;
+        memcpy(&value, take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    std::string getString()
+    {
+        const uint32_t size = get<uint32_t>();
+        return std::string(take(size), size);
+    }
+
+    bool atEnd() const { return pos == data.size(); }
+
+  private: // functions
+    const char* take(size_t size)
+    {
+        if ( size > data.size() - pos )
+            throw std::runtime_error("Corrupted record in the cluster cache");
+        const char* p = data.data() + pos;
+        pos += size;
+        return p;
+    }
+
+  private: // data
+    const std::string& data;
+    size_t pos = 0;
+};
+
+} // unnamed namespace
+
+ClusterResult::Blob& ClusterResult::blob(size_t blobIndex)
+{
+    if ( blobIndex >= blobs.size() )
+        blobs.resize(blobIndex + 1);
+    return blobs[blobIndex];
+}
+
+std::string ClusterResult::serialize() const
+{
+    std::string record;
+    put<uint32_t>(record, blobs.size());
+    for ( const auto& b : blobs ) {
+        const uint8_t flags = (b.checked ? CHECKED : 0)
+                            | (b.hashed ? HASHED : 0)
+                            | (b.scanned ? SCANNED : 0);
+        put<uint8_t>(record, flags);
+        if ( !b.checked )
+            continue;
+        put<uint64_t>(record, b.size);
+        if ( b.hashed ) {
+            put<uint64_t>(record, b.hash.low);
+            put<uint64_t>(record, b.hash.high);
+        }
+        if ( b.scanned ) {
+            put<uint32_t>(record, b.links.size());
+            for ( const auto& l : b.links ) {
+                putString(record, l.first);
+                putString(record, l.second);
+            }
+        }
+    }
+    return record;
+}
+
+ClusterResult ClusterResult::deserialize(const std::string& record)
+{
+    RecordReader in(record);
+    ClusterResult result;
+    result.blobs.resize(in.get<uint32_t>());
+    for ( auto& b : result.blobs ) {
+        const uint8_t flags = in.get<uint8_t>();
+        b.checked = flags & CHECKED;
+        if ( !b.checked )
+            continue;
+        b.size = in.get<uint64_t>();
+        b.hashed = flags & HASHED;
+        if ( b.hashed ) {
+            b.hash.low = in.get<uint64_t>();
+            b.hash.high = in.get<uint64_t>();
+        }
+        b.scanned = flags & SCANNED;
+        if ( b.scanned ) {
+            b.links.resize(in.get<uint32_t>());
+            for ( auto& l : b.links ) {
+                l.first = in.getString();
+                l.second = in.getString();
+            }
+        }
+    }
+    if ( !in.atEnd() )
+        throw std::runtime_error("Corrupted record in the cluster cache");
+    return result;
+}
+
+ClusterCache::ClusterCache(const std::string& path)
+    : in(path, std::ios::binary)
+{
+    std::string header(HEADER.size(), '\0');
+    if ( !in.read(&header[0], header.size()) || header != HEADER )
+        return;
+
+    uint64_t trailer[3];
+    in.seekg(-std::streamoff(TRAILER_SIZE), std::ios::end);
+    const uint64_t trailerOffset = in.tellg();
+    if ( !in.read(reinterpret_cast<char*>(trailer), TRAILER_SIZE) || trailer[2] != TRAILER_MAGIC )
+        return;
+
+    const uint64_t count = trailer[0];
+    if ( trailer[1] > trailerOffset || (trailerOffset - trailer[1]) / INDEX_ENTRY_SIZE != count )
+        return;
+    std::vector<uint64_t> entries(4 * count);
+    in.seekg(trailer[1]);
+    if ( !in.read(reinterpret_cast<char*>(entries.data()), count * INDEX_ENTRY_SIZE) )
+        return;
+
+    index.reserve(count);
+    for ( size_t i = 0; i < count; ++i ) {
+        const uint64_t* e = &entries[4 * i];
+        index.push_back({Hash128{e[0], e[1]}, e[2], e[3]});
+    }
+    std::sort(index.begin(), index.end(), [](const IndexEntry& a, const IndexEntry& b) {
+        return a.hash < b.hash;
+    });
+}
+
+bool ClusterCache::find(const Hash128& clusterHash, std::string& record) const
+{
+    const auto it = std::lower_bound(index.begin(), index.end(), clusterHash,
+        [](const IndexEntry& e, const Hash128& h) { return e.hash < h; });
+    if ( it == index.end() || it->hash != clusterHash )
+        return false;
+
+    record.resize(it->size);
+    std::lock_guard<std::mutex> lock(mutex);
+    in.clear();
+    in.seekg(it->offset);
+    return bool(in.read(&record[0], record.size()));
+}
+
+ClusterCacheWriter::ClusterCacheWriter(const std::string& _path)
+    : path(_path)
+    , tmpPath(_path + ".tmp")
+    , out(tmpPath, std::ios::binary | std::ios::trunc)
+{
+    if ( !out )
+        throw std::runtime_error("Cannot write the cluster cache " + tmpPath);
+    out << HEADER;
+}
+
+ClusterCacheWriter::~ClusterCacheWriter()
+{
+    if ( !committed ) {
+        out.close();
+        std::remove(tmpPath.c_str());
+    }
+}
+
+void ClusterCacheWriter::add(const Hash128& clusterHash, const std::string& record)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const uint64_t offset = out.tellp();
+    out.write(record.data(), record.size());
+    index.push_back({clusterHash, {offset, record.size()}});
+}
+
+size_t ClusterCacheWriter::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.size();
+}
+
+void ClusterCacheWriter::commit()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const uint64_t indexOffset = out.tellp();
+    for ( const auto& e : index ) {
+        const uint64_t entry[4] = { e.first.low, e.first.high, e.second.first, e.second.second };
+        out.write(reinterpret_cast<const char*>(entry), INDEX_ENTRY_SIZE);
+    }
+    const uint64_t trailer[3] = { index.size(), indexOffset, TRAILER_MAGIC };
+    out.write(reinterpret_cast<const char*>(trailer), TRAILER_SIZE);
+    out.close();
+    if ( !out )
+        throw std::runtime_error("Cannot write the cluster cache " + tmpPath);
+
+    std::remove(path.c_str());
+    if ( std::rename(tmpPath.c_str(), path.c_str()) != 0 )
+        throw std::runtime_error("Cannot write the cluster cache " + path);
+    committed = true;
+}
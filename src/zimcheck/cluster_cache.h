@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_CLUSTER_CACHE_H_
+#define _ZIM_TOOL_CLUSTER_CACHE_H_
+
+#include "../tools.h"
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Results of the article checks of the items of a cluster that depend only
+// on the content of the cluster. They let the checks of an identical cluster
+// (found in a later release of an archive) skip the decompression of the
+// cluster and the scanning of its HTML items.
+struct ClusterResult
+{
+    struct Blob
+    {
+        // Whether the blob was checked at all
+        bool checked = false;
+        uint64_t size = 0;
+
+        // Content hash, computed for the redundancy check
+        bool hashed = false;
+        Hash128 hash{0, 0};
+
+        // (attribute, link) pairs of an HTML item, in order of appearance
+        bool scanned = false;
+        std::vector<std::pair<std::string, std::string>> links;
+    };
+
+    // Indexed by blob index
+    std::vector<Blob> blobs;
+
+    Blob& blob(size_t blobIndex);
+
+    std::string serialize() const;
+
+    // Throws std::runtime_error if the record is corrupted
+    static ClusterResult deserialize(const std::string& record);
+};
+
+// Read-only cache of the results of the checks of clusters, keyed by the
+// hash of the (compressed) content of the cluster.
+//
+// The index of the cache is loaded in memory, while the results are read
+// from the file on demand. A missing file, or one written by another
+// version of zimcheck, results in an empty cache.
+class ClusterCache
+{
+  public: // functions
+    explicit ClusterCache(const std::string& path);
+
+    size_t size() const { return index.size(); }
+
+    // Gets the serialized results of the cluster with the given hash.
+    // Can be called concurrently.
+    bool find(const Hash128& clusterHash, std::string& record) const;
+
+  private: // types
+    struct IndexEntry
+    {
+        Hash128 hash;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+  private: // data
+    std::vector<IndexEntry> index;
+    mutable std::ifstream in;
+    mutable std::mutex mutex;
+};
+
+// Writes a new cache of the results of the checks of clusters.
+//
+// The cache is written to a temporary file that replaces the cache file
+// only once commit() is called, so that an interrupted check doesn't leave
+// an incomplete cache behind.
+class ClusterCacheWriter
+{
+  public: // functions
+    explicit ClusterCacheWriter(const std::string& path);
+    ~ClusterCacheWriter();
+
+    ClusterCacheWriter(const ClusterCacheWriter&) = delete;
+    ClusterCacheWriter& operator=(const ClusterCacheWriter&) = delete;
+
+    // Can be called concurrently
+    void add(const Hash128& clusterHash, const std::string& record);
+
+    size_t size() const;
+
+    void commit();
+
+  private: // data
+    const std::string path;
+    const std::string tmpPath;
+    std::ofstream out;
+    std::vector<std::pair<Hash128, std::pair<uint64_t, uint64_t>>> index;
+    mutable std::mutex mutex;
+    bool committed = false;
+};
+
+#endif // _ZIM_TOOL_CLUSTER_CACHE_H_
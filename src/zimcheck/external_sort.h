@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_EXTERNAL_SORT_H_
+#define _ZIM_TOOL_EXTERNAL_SORT_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Items collected by one thread, to be sorted with those of other threads
+// by SortedRunMerger.
+//
+// The items are buffered in memory. Once the buffer is full, it is sorted
+// and spilled to a temporary file as a sorted run, so that the memory used
+// doesn't depend on the count of items.
+template<class T>
+class SortedRuns
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Items are written as raw bytes");
+
+public: // functions
+    explicit SortedRuns(size_t _maxBufferedItems = SIZE_MAX)
+        : maxBufferedItems(std::max<size_t>(_maxBufferedItems, 1))
+    {}
+
+    SortedRuns(SortedRuns&&) = default;
+    SortedRuns& operator=(SortedRuns&&) = default;
+
+    void add(const T& item)
+    {
+        buffer.push_back(item);
+        if ( buffer.size() >= maxBufferedItems )
+            spill();
+    }
+
+    size_t size() const { return spilledItems + buffer.size(); }
+    size_t spilledRunCount() const { return runs.size(); }
+
+private: // types
+    struct FileCloser
+    {
+        void operator()(std::FILE* f) const { std::fclose(f); }
+    };
+
+    // Offset (in items) and count of items of a run
+    typedef std::pair<uint64_t, uint64_t> Run;
+
+private: // functions
+    void spill()
+    {
+        if ( !file )
+            file.reset(std::tmpfile());
+        if ( !file )
+            throw std::runtime_error("Cannot create a temporary file");
+        std::sort(buffer.begin(), buffer.end());
+        std::fseek(file.get(), 0, SEEK_END);
+        if ( std::fwrite(buffer.data(), sizeof(T), buffer.size(), file.get()) != buffer.size() )
+            throw std::runtime_error("Cannot write to a temporary file");
+        runs.emplace_back(spilledItems, buffer.size());
+        spilledItems += buffer.size();
+        buffer.clear();
+    }
+
+    template<class U> friend class SortedRunMerger;
+
+private: // data
+    size_t maxBufferedItems;
+    std::vector<T> buffer;
+    std::unique_ptr<std::FILE, FileCloser> file;
+    std::vector<Run> runs;
+    size_t spilledItems = 0;
+};
+
+// Merges the sorted runs (spilled or still in memory) of several
+// SortedRuns, returning all their items in order.
+template<class T>
+class SortedRunMerger
+{
+public: // functions
+    // Every run spilled to a file is read through a buffer of
+    // readBufferItems items
+    SortedRunMerger(std::vector<SortedRuns<T>*> sources, size_t _readBufferItems = 4096)
+        : readBufferItems(std::max<size_t>(_readBufferItems, 1))
+    {
+        for ( auto source : sources ) {
+            std::sort(source->buffer.begin(), source->buffer.end());
+            for ( const auto& run : source->runs )
+                addCursor(source->file.get(), run.first, run.second, nullptr);
+            if ( !source->buffer.empty() )
+                addCursor(nullptr, 0, source->buffer.size(), &source->buffer);
+        }
+    }
+
+    bool next(T& item)
+    {
+        if ( heap.empty() )
+            return false;
+        Cursor* const c = heap.top();
+        heap.pop();
+        item = c->current();
+        if ( c->advance(readBufferItems) )
+            heap.push(c);
+        return true;
+    }
+
+private: // types
+    // Position in a run of a file (or in a buffer in memory)
+    struct Cursor
+    {
+        std::FILE* file;
+        uint64_t next;  // offset of the next item to read from the file
+        uint64_t left;  // items of the run not read from the file yet
+        const std::vector<T>* items;
+        std::vector<T> chunk;
+        size_t pos = 0;
+
+        const T& current() const { return (*items)[pos]; }
+
+        bool advance(size_t readBufferItems)
+        {
+            if ( ++pos < items->size() )
+                return true;
+            return file && load(readBufferItems);
+        }
+
+        bool load(size_t readBufferItems)
+        {
+            if ( left == 0 )
+                return false;
+            chunk.resize(std::min<uint64_t>(left, readBufferItems));
+            if ( !seek(file, next * sizeof(T))
+              || std::fread(chunk.data(), sizeof(T), chunk.size(), file) != chunk.size() )
+                throw std::runtime_error("Cannot read a temporary file");
+            next += chunk.size();
+            left -= chunk.size();
+            items = &chunk;
+            pos = 0;
+            return true;
+        }
+    };
+
+    static bool seek(std::FILE* file, uint64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+        return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+    }
+
+    struct CursorGreater
+    {
+        bool operator()(const Cursor* a, const Cursor* b) const
+        {
+            return b->current() < a->current();
+        }
+    };
+
+private: // functions
+    void addCursor(std::FILE* file, uint64_t offset, uint64_t count, const std::vector<T>* items)
+    {
+        cursors.emplace_back(new Cursor{file, offset, count, items});
+        Cursor* const c = cursors.back().get();
+        if ( file ? c->load(readBufferItems) : !items->empty() )
+            heap.push(c);
+    }
+
+private: // data
+    const size_t readBufferItems;
+    std::vector<std::unique_ptr<Cursor>> cursors;
+    std::priority_queue<Cursor*, std::vector<Cursor*>, CursorGreater> heap;
+};
+
+#endif // _ZIM_TOOL_EXTERNAL_SORT_H_
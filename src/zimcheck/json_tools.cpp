@@ -19,11 +19,14 @@
 
 #include "json_tools.h"
 
+#include <cstring>
+
 namespace JSON
 {
 
-OutputStream::OutputStream(std::ostream* out)
+OutputStream::OutputStream(std::ostream* out, bool compact)
   : m_out(out)
+  , m_compact(compact)
 {
 }
 
@@ -32,12 +35,18 @@ const char* OutputStream::sep() const
   if ( m_nesting.empty() )
     return "";
 
-  return m_nesting.top().hasData ? ",\n" : "";
+  if ( !m_nesting.top().hasData )
+    return "";
+
+  return m_compact ? "," : ",\n";
 }
 
-std::string OutputStream::indentation() const
+void OutputStream::indent() const
 {
-  return std::string(2*m_nesting.size(), ' ');
+  if ( !m_compact ) {
+    for ( size_t i = 0; i < m_nesting.size(); ++i )
+      *m_out << "  ";
+  }
 }
 
 void OutputStream::output(bool b)
@@ -51,22 +60,23 @@ void OutputStream::output(const char* s)
   m_nesting.top().hasData = true;
   auto& out = *m_out;
   out << '\"';
+  // The runs of characters not needing any escaping are output at once
+  const char* run = s;
   for (const char* p = s; *p; ++p) {
-    if (*p == '\"' || *p == '\\') {
-      out << '\\' << *p;
-    } else if ( *p == '\n' ) {
-      out << "\\n";
-    } else {
-      out << *p;
+    if (*p == '\"' || *p == '\\' || *p == '\n') {
+      out.write(run, p - run);
+      out << (*p == '\n' ? "\\n" : *p == '\"' ? "\\\"" : "\\\\");
+      run = p + 1;
     }
   }
+  out.write(run, strlen(run));
   out << '\"';
 }
 
 void OutputStream::output(StartObject)
 {
   if ( m_out ) {
-    *m_out << "{\n" << std::flush;
+    *m_out << (m_compact ? "{" : "{\n");
   }
   m_nesting.push(ScopeInfo{OBJECT, false});
 }
@@ -77,7 +87,9 @@ void OutputStream::output(EndObject)
   assert(m_nesting.top().type == OBJECT);
   m_nesting.pop();
   if ( m_out ) {
-    *m_out << "\n" << indentation() << "}" << std::flush;
+    *m_out << (m_compact ? "" : "\n");
+    indent();
+    *m_out << "}";
   }
   if ( !m_nesting.empty() ) {
     m_nesting.top().hasData = true;
@@ -89,7 +101,7 @@ void OutputStream::output(EndObject)
 void OutputStream::output(StartArray)
 {
   if ( m_out ) {
-    *m_out << "[\n" << std::flush;
+    *m_out << (m_compact ? "[" : "[\n");
   }
   m_nesting.push(ScopeInfo{ARRAY, false});
 }
@@ -98,10 +110,12 @@ OutputStream& OutputStream::operator<<(EndArray)
 {
   assert(!m_nesting.empty());
   assert(m_nesting.top().type == ARRAY);
-  const char* s = m_nesting.top().hasData ? "\n" : "";
+  const char* s = m_nesting.top().hasData && !m_compact ? "\n" : "";
   m_nesting.pop();
   if ( m_out ) {
-    *m_out << s << indentation() << "]" << std::flush;
+    *m_out << s;
+    indent();
+    *m_out << "]";
   }
   if ( !m_nesting.empty() ) {
     m_nesting.top().hasData = true;
@@ -48,7 +48,9 @@ enum EndArray    { endArray    };
 class OutputStream
 {
 public: // functions
-  explicit OutputStream(std::ostream* out);
+  // A compact stream outputs each top-level value on a single line (without
+  // any indentation).
+  explicit OutputStream(std::ostream* out, bool compact = false);
 
   bool enabled() const { return m_out != nullptr; }
 
@@ -61,7 +63,7 @@ public: // functions
 
 private: // functions
   const char* sep() const;
-  std::string indentation() const;
+  void indent() const;
 
   void output(bool b);
   void output(const char* s);
@@ -84,6 +86,7 @@ private: // types
 
 private: // data
   std::ostream* const m_out;
+  const bool m_compact;
   std::stack<ScopeInfo> m_nesting;
 };
 
@@ -91,8 +94,10 @@ template<class T>
 OutputStream& OutputStream::operator<<(const T& t)
 {
   if ( m_out ) {
-    if ( !m_nesting.empty() && m_nesting.top().type == ARRAY )
-      *m_out << sep() << indentation();
+    if ( !m_nesting.empty() && m_nesting.top().type == ARRAY ) {
+      *m_out << sep();
+      indent();
+    }
     output(t);
   }
   return *this;
@@ -101,12 +106,12 @@ OutputStream& OutputStream::operator<<(const T& t)
 template<class T>
 void OutputStream::output(const Property<T>& p)
 {
-    *m_out << sep() << indentation();
+    *m_out << sep();
+    indent();
     m_nesting.top().hasData = true;
     *this  << p.key;
-    *m_out << " : ";
+    *m_out << (m_compact ? ":" : " : ");
     *this  << p.value;
-    *m_out << std::flush;
 }
 
 } // namespace JSON
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "link_graph.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+namespace
+{
+
+const char MAGIC[8] = {'Z', 'I', 'M', 'L', 'I', 'N', 'K', 'G'};
+const uint32_t VERSION_1 = 1;
+
+// A level of the breadth-first search is explored in parallel by chunks of
+// this count of nodes
+const size_t FRONTIER_CHUNK_SIZE = 4096;
+
+void putLE(std::string& out, uint64_t value, size_t size)
+{
+    for ( size_t i = 0; i < size; ++i, value >>= 8 )
+        out += char(value & 0xff);
+}
+
+void putVarint(std::string& out, uint32_t value)
+{
+    for ( ; value >= 0x80; value >>= 7 )
+        out += char((value & 0x7f) | 0x80);
+    out += char(value);
+}
+
+uint64_t getLE(const std::string& in, size_t& pos, size_t size)
+{
+    if ( size > in.size() - pos )
+        throw std::runtime_error("Truncated link graph");
+    uint64_t value = 0;
+    for ( size_t i = 0; i < size; ++i )
+        value |= uint64_t(uint8_t(in[pos + i])) << (8 * i);
+    pos += size;
+    return value;
+}
+
+uint32_t getVarint(const std::string& in, size_t& pos, size_t end)
+{
+    uint64_t value = 0;
+    for ( unsigned shift = 0; pos < end && shift < 35; shift += 7 ) {
+        const uint8_t byte = in[pos++];
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ( !(byte & 0x80) ) {
+            if ( value > UINT32_MAX )
+                break;
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupted link graph");
+}
+
+} // unnamed namespace
+
+void LinkGraph::Part::add(Node source, std::vector<Node>& nodeTargets)
+{
+    std::sort(nodeTargets.begin(), nodeTargets.end());
+    nodeTargets.erase(std::unique(nodeTargets.begin(), nodeTargets.end()), nodeTargets.end());
+    if ( nodeTargets.empty() )
+        return;
+    rows.emplace_back(source, nodeTargets.size());
+    targets.insert(targets.end(), nodeTargets.begin(), nodeTargets.end());
+}
+
+LinkGraph::LinkGraph(size_t nodeCount, const std::vector<const Part*>& parts)
+    : offsets(nodeCount + 1, 0)
+{
+    for ( const auto part : parts ) {
+        for ( const auto& row : part->rows )
+            offsets.at(row.first + 1) = row.second;
+    }
+    for ( size_t n = 0; n < nodeCount; ++n )
+        offsets[n + 1] += offsets[n];
+
+    targets.resize(offsets.back());
+    for ( const auto part : parts ) {
+        auto src = part->targets.begin();
+        for ( const auto& row : part->rows ) {
+            std::copy(src, src + row.second, targets.begin() + offsets[row.first]);
+            src += row.second;
+        }
+    }
+}
+
+std::vector<uint32_t> LinkGraph::inDegrees() const
+{
+    std::vector<uint32_t> degrees(nodeCount(), 0);
+    for ( const auto target : targets )
+        ++degrees[target];
+    return degrees;
+}
+
+std::vector<bool> LinkGraph::reachableFrom(Node start, WorkerPool* workerPool) const
+{
+    // Every node is claimed by the thread that visits it first
+    std::unique_ptr<std::atomic<bool>[]> visited(new std::atomic<bool>[nodeCount()]);
+    for ( size_t n = 0; n < nodeCount(); ++n )
+        visited[n].store(false, std::memory_order_relaxed);
+
+    const auto explore = [this, &visited](const Node* begin, const Node* end, std::vector<Node>& next) {
+        for ( auto node = begin; node != end; ++node ) {
+            for ( auto t = beginTargets(*node); t != endTargets(*node); ++t ) {
+                if ( !visited[*t].load(std::memory_order_relaxed)
+                  && !visited[*t].exchange(true, std::memory_order_relaxed) )
+                    next.push_back(*t);
+            }
+        }
+    };
+
+    std::vector<Node> frontier;
+    if ( start < nodeCount() ) {
+        visited[start] = true;
+        frontier.push_back(start);
+    }
+    // The next level is collected chunk by chunk, in order
+    std::vector<std::vector<Node>> nexts;
+    while ( !frontier.empty() ) {
+        const size_t chunkCount = (frontier.size() + FRONTIER_CHUNK_SIZE - 1) / FRONTIER_CHUNK_SIZE;
+        nexts.resize(std::max(nexts.size(), chunkCount));
+        const auto exploreChunks = [&](size_t begin, size_t end) {
+            explore(frontier.data() + begin, frontier.data() + end, nexts[begin / FRONTIER_CHUNK_SIZE]);
+        };
+        if ( workerPool && chunkCount > 1 )
+            workerPool->forEachRange(frontier.size(), FRONTIER_CHUNK_SIZE, exploreChunks);
+        else
+            exploreChunks(0, frontier.size());
+
+        frontier.clear();
+        for ( auto& next : nexts ) {
+            frontier.insert(frontier.end(), next.begin(), next.end());
+            next.clear();
+        }
+    }
+
+    std::vector<bool> result(nodeCount());
+    for ( size_t n = 0; n < nodeCount(); ++n )
+        result[n] = visited[n].load(std::memory_order_relaxed);
+    return result;
+}
+
+void LinkGraph::write(const std::string& path) const
+{
+    std::string data;
+    std::vector<uint64_t> dataOffsets;
+    dataOffsets.reserve(offsets.size());
+    for ( size_t n = 0; n < nodeCount(); ++n ) {
+        dataOffsets.push_back(data.size());
+        Node previous = 0;
+        for ( auto t = beginTargets(n); t != endTargets(n); ++t ) {
+            putVarint(data, *t - previous);
+            previous = *t;
+        }
+    }
+    dataOffsets.push_back(data.size());
+
+    std::string header(MAGIC, sizeof(MAGIC));
+    putLE(header, VERSION_1, 4);
+    putLE(header, 0, 4);
+    putLE(header, nodeCount(), 8);
+    putLE(header, linkCount(), 8);
+    putLE(header, data.size(), 8);
+    for ( const auto offset : dataOffsets )
+        putLE(header, offset, 8);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(header.data(), header.size());
+    out.write(data.data(), data.size());
+    out.close();
+    if ( !out )
+        throw std::runtime_error("Cannot write the link graph " + path);
+}
+
+LinkGraph LinkGraph::read(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if ( !in )
+        throw std::runtime_error("Cannot read the link graph " + path);
+    const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    size_t pos = 0;
+    if ( content.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0 )
+        throw std::runtime_error("Not a link graph: " + path);
+    pos += sizeof(MAGIC);
+    if ( getLE(content, pos, 4) != VERSION_1 )
+        throw std::runtime_error("Unsupported version of the link graph " + path);
+    getLE(content, pos, 4);
+    const uint64_t nodeCount = getLE(content, pos, 8);
+    const uint64_t linkCount = getLE(content, pos, 8);
+    const uint64_t dataSize = getLE(content, pos, 8);
+    if ( nodeCount > UINT32_MAX || (content.size() - pos) / 8 <= nodeCount
+      || content.size() - pos - 8 * (nodeCount + 1) != dataSize )
+        throw std::runtime_error("Corrupted link graph " + path);
+
+    std::vector<uint64_t> dataOffsets(nodeCount + 1);
+    for ( auto& offset : dataOffsets )
+        offset = getLE(content, pos, 8);
+
+    LinkGraph graph;
+    graph.offsets.resize(nodeCount + 1);
+    graph.targets.reserve(linkCount);
+    const size_t dataStart = pos;
+    for ( size_t n = 0; n < nodeCount; ++n ) {
+        if ( dataOffsets[n] > dataOffsets[n + 1] || dataOffsets[n + 1] > dataSize )
+            throw std::runtime_error("Corrupted link graph " + path);
+        size_t p = dataStart + dataOffsets[n];
+        const size_t end = dataStart + dataOffsets[n + 1];
+        uint64_t target = 0;
+        while ( p < end ) {
+            target += getVarint(content, p, end);
+            if ( target >= nodeCount )
+                throw std::runtime_error("Corrupted link graph " + path);
+            graph.targets.push_back(target);
+        }
+        graph.offsets[n + 1] = graph.targets.size();
+    }
+    if ( graph.targets.size() != linkCount )
+        throw std::runtime_error("Corrupted link graph " + path);
+    return graph;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_LINK_GRAPH_H_
+#define _ZIM_TOOL_LINK_GRAPH_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+// Directed graph of the links between the entries of an archive, stored in
+// compressed sparse row (CSR) form: the targets of the links of node n are
+// targets[offsets[n]] to targets[offsets[n+1]-1], in increasing order.
+//
+// The nodes are the entry indices. A redirection is a node with a single
+// link (to the entry it redirects to).
+class LinkGraph
+{
+  public: // types
+    typedef uint32_t Node;
+
+    // The links of some of the nodes, collected by one thread
+    class Part
+    {
+      public: // functions
+        // Adds the links of a node (which must not have been added before).
+        // The targets are sorted and deduplicated in place.
+        void add(Node source, std::vector<Node>& targets);
+
+        size_t linkCount() const { return targets.size(); }
+
+      private: // data
+        friend class LinkGraph;
+
+        // (node, count of links) of every added node
+        std::vector<std::pair<Node, uint32_t>> rows;
+        std::vector<Node> targets;
+    };
+
+  public: // functions
+    LinkGraph() = default;
+
+    // Assembles the graph of nodeCount nodes from the parts collected by
+    // several threads
+    LinkGraph(size_t nodeCount, const std::vector<const Part*>& parts);
+
+    size_t nodeCount() const { return offsets.size() - 1; }
+    size_t linkCount() const { return targets.size(); }
+
+    const Node* beginTargets(Node node) const { return targets.data() + offsets[node]; }
+    const Node* endTargets(Node node) const { return targets.data() + offsets[node + 1]; }
+
+    std::vector<uint32_t> inDegrees() const;
+
+    // Nodes reachable from the start node (breadth-first search, the big
+    // levels of which are explored on the workers of the pool, if any)
+    std::vector<bool> reachableFrom(Node start, WorkerPool* workerPool = nullptr) const;
+
+    // File format (integers are stored little-endian):
+    //
+    //   magic       "ZIMLINKG"
+    //   version     uint32 (1), then uint32 (0)
+    //   counts      uint64 count of nodes, uint64 count of links,
+    //               uint64 size of the link data
+    //   offsets     uint64 offset in the link data of the links of every
+    //               node, and the size of the link data
+    //   link data   targets of the links of every node, in increasing
+    //               order, each one encoded as the LEB128 varint of the
+    //               difference with the previous one (the first one being
+    //               encoded as is)
+    //
+    // Both throw std::runtime_error on failure.
+    void write(const std::string& path) const;
+    static LinkGraph read(const std::string& path);
+
+  private: // data
+    std::vector<uint64_t> offsets{0};
+    std::vector<Node> targets;
+};
+
+#endif // _ZIM_TOOL_LINK_GRAPH_H_
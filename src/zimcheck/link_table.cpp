@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "link_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+
+// The low bits of an id select the shard, the high bits the record
+const unsigned SHARD_BITS = 6;
+const size_t SHARD_COUNT = size_t(1) << SHARD_BITS;
+const size_t MAX_RECORDS_PER_SHARD = size_t(1) << (32 - SHARD_BITS);
+
+const size_t MIN_BLOCK_SIZE = 256;
+const size_t MAX_BLOCK_SIZE = 64 * 1024;
+
+// Approximate memory used by a link besides its text (the record and the
+// node of the hash map)
+const size_t LINK_OVERHEAD = 96;
+
+// Memory used by a bucket of a hash map
+const size_t BUCKET_SIZE = sizeof(void*);
+
+} // unnamed namespace
+
+LinkTable::LinkTable(size_t _maxMemory)
+    : maxMemory(_maxMemory)
+    , shards(SHARD_COUNT)
+{}
+
+LinkTable::Record* LinkTable::insert(std::string_view link, Link& result)
+{
+    const size_t shardIndex = std::hash<std::string_view>()(link) % SHARD_COUNT;
+    Shard& shard = shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.ids.find(link);
+    if ( it != shard.ids.end() ) {
+        result.id = it->second;
+        result.resolved = false;
+        return &shard.records[it->second >> SHARD_BITS];
+    }
+
+    if ( shard.records.size() == MAX_RECORDS_PER_SHARD )
+        return nullptr;
+
+    // The hash map doubles its count of buckets once it is full
+    const size_t bucketCount = shard.ids.bucket_count();
+    const bool rehash = shard.ids.size() + 1 > bucketCount * shard.ids.max_load_factor();
+    const size_t blockSize = newBlockSize(shard, link);
+    const size_t cost = LINK_OVERHEAD + blockSize + (rehash ? 2 * bucketCount * BUCKET_SIZE : 0);
+    if ( !reserve(cost) )
+        return nullptr;
+
+    result.id = Id((shard.records.size() << SHARD_BITS) | shardIndex);
+    result.resolved = true;
+    shard.records.emplace_back();
+    Record& record = shard.records.back();
+    record.link = store(shard, link, blockSize);
+    shard.ids.emplace(record.link, result.id);
+
+    // Corrects the estimation of the new buckets with their actual count
+    if ( rehash ) {
+        usedMemory -= 2 * bucketCount * BUCKET_SIZE;
+        usedMemory += (shard.ids.bucket_count() - bucketCount) * BUCKET_SIZE;
+    }
+    return &record;
+}
+
+bool LinkTable::reserve(size_t size)
+{
+    size_t used = usedMemory.load();
+    do {
+        if ( used + size > maxMemory )
+            return false;
+    } while ( !usedMemory.compare_exchange_weak(used, used + size) );
+    return true;
+}
+
+void LinkTable::publish(Id id, Record& record, Target target)
+{
+    const Shard& shard = shards[id & (SHARD_COUNT - 1)];
+    {
+        // Under the lock, so that a waiting thread can't miss the
+        // notification between its check of the target and its wait
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        record.target.store(target, std::memory_order_release);
+    }
+    shard.resolved.notify_all();
+}
+
+LinkTable::Target LinkTable::wait(Id id, const Record& record) const
+{
+    Target target = record.target.load(std::memory_order_acquire);
+    if ( target == PENDING ) {
+        const Shard& shard = shards[id & (SHARD_COUNT - 1)];
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        shard.resolved.wait(lock, [&]() {
+            target = record.target.load(std::memory_order_acquire);
+            return target != PENDING;
+        });
+    }
+    if ( target == FAILED )
+        throw std::runtime_error("Cannot resolve the link " + std::string(record.link));
+    return target;
+}
+
+size_t LinkTable::newBlockSize(const Shard& shard, std::string_view link)
+{
+    if ( shard.blockNext && link.size() <= shard.blockFree )
+        return 0;
+    const size_t blockSize = std::min(std::max(2 * shard.blockSize, MIN_BLOCK_SIZE), MAX_BLOCK_SIZE);
+    return std::max(blockSize, link.size());
+}
+
+std::string_view LinkTable::store(Shard& shard, std::string_view link, size_t blockSize)
+{
+    if ( blockSize ) {
+        // The links longer than a block don't make the next blocks bigger
+        if ( blockSize <= MAX_BLOCK_SIZE )
+            shard.blockSize = blockSize;
+        shard.blocks.emplace_back(new char[blockSize]);
+        shard.blockNext = shard.blocks.back().get();
+        shard.blockFree = blockSize;
+    }
+    char* const p = shard.blockNext;
+    std::memcpy(p, link.data(), link.size());
+    shard.blockNext += link.size();
+    shard.blockFree -= link.size();
+    return std::string_view(p, link.size());
+}
+
+size_t LinkTable::size() const
+{
+    size_t count = 0;
+    for ( const auto& shard : shards ) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        count += shard.records.size();
+    }
+    return count;
+}
+
+std::string_view LinkTable::link(Id id) const
+{
+    return shards.at(id & (SHARD_COUNT - 1)).records.at(id >> SHARD_BITS).link;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_LINK_TABLE_H_
+#define _ZIM_TOOL_LINK_TABLE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Concurrent table interning the (normalized) internal links found in the
+// articles of an archive. Every distinct link gets an integer id and is
+// resolved exactly once, by the thread that interns it first (the threads
+// interning it meanwhile wait for the result).
+//
+// The table is split into shards selected by the hash of the link, each
+// with its own lock. The links are never evicted: once the memory limit is
+// reached, new links are not interned any more. The memory used includes the
+// blocks storing the text of the links and the buckets of the hash maps.
+class LinkTable
+{
+  public: // types
+    typedef uint32_t Id;
+
+    // Result of the resolution of a link (its meaning is up to the user of
+    // the table, e.g. the entry index of the target of the link)
+    typedef int64_t Target;
+
+    struct Link
+    {
+        Id id;
+        Target target;
+
+        // Whether the link was resolved by this call to intern()
+        bool resolved;
+    };
+
+  public: // functions
+    explicit LinkTable(size_t maxMemory);
+
+    LinkTable(const LinkTable&) = delete;
+    LinkTable& operator=(const LinkTable&) = delete;
+
+    // Interns the link and gets its resolution, obtained by calling
+    // resolve(link) if the link is new. Returns false if the link is not in
+    // the table and the table is full.
+    template<class F>
+    bool intern(std::string_view link, Link& result, F resolve)
+    {
+        Record* const record = insert(link, result);
+        if ( !record )
+            return false;
+        if ( !result.resolved ) {
+            result.target = wait(result.id, *record);
+            return true;
+        }
+
+        try {
+            result.target = resolve(std::string(link));
+        } catch (...) {
+            publish(result.id, *record, FAILED);
+            throw;
+        }
+        publish(result.id, *record, result.target);
+        return true;
+    }
+
+    // Count of distinct links and approximate memory used by the table
+    size_t size() const;
+    size_t memoryUsage() const { return usedMemory; }
+
+    // The link with the given id (not to be called concurrently with
+    // intern())
+    std::string_view link(Id id) const;
+
+  private: // types
+    enum : Target
+    {
+        PENDING = INT64_MIN,
+        FAILED = INT64_MIN + 1
+    };
+
+    struct Record
+    {
+        std::string_view link;
+        std::atomic<Target> target{PENDING};
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+
+        // Notified when a link of the shard is resolved
+        mutable std::condition_variable resolved;
+
+        std::unordered_map<std::string_view, Id> ids;
+
+        // Indexed by the local part of the ids (deques keep the addresses
+        // of their elements)
+        std::deque<Record> records;
+
+        // The text of the links, in blocks that are never reallocated (of
+        // growing size, so that the small tables don't waste memory)
+        std::vector<std::unique_ptr<char[]>> blocks;
+        size_t blockSize = 0;
+        char* blockNext = nullptr;
+        size_t blockFree = 0;
+    };
+
+  private: // functions
+    // Finds or adds the record of the link (nullptr if the table is full)
+    Record* insert(std::string_view link, Link& result);
+
+    // Size of the block to allocate for storing the link (0 if it fits in
+    // the current block of the shard)
+    static size_t newBlockSize(const Shard& shard, std::string_view link);
+    std::string_view store(Shard& shard, std::string_view link, size_t blockSize);
+
+    // Accounts memory if it stays within the limit
+    bool reserve(size_t size);
+
+    // Sets the resolution of a link and wakes up the threads waiting for it
+    void publish(Id id, Record& record, Target target);
+
+    // Waits for the resolution of a link by another thread
+    Target wait(Id id, const Record& record) const;
+
+  private: // data
+    const size_t maxMemory;
+    std::atomic<size_t> usedMemory{0};
+    std::vector<Shard> shards;
+};
+
+#endif // _ZIM_TOOL_LINK_TABLE_H_
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_MD5_H_
+#define _ZIM_TOOL_MD5_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Incremental MD5 (RFC 1321), as used by the checksum of ZIM files
+class Md5
+{
+public: // types
+    typedef std::array<uint8_t, 16> Digest;
+
+public: // functions
+    Md5();
+
+    void update(const char* data, size_t size);
+
+    // The object must not be updated after the digest is computed
+    Digest digest();
+
+    static std::string toHex(const Digest& digest);
+
+private: // functions
+    void processBlock(const uint8_t* block);
+
+private: // data
+    uint32_t state[4];
+    uint64_t byteCount = 0;
+    uint8_t buffer[64];
+};
+
+#endif // _ZIM_TOOL_MD5_H_
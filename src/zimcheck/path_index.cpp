@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "path_index.h"
+#include "worker_pool.h"
+#include "../tools.h"
+
+#include <zim/archive.h>
+
+namespace
+{
+
+// Count of slots of the hash table for entryCount entries (the load factor
+// is kept at or below 1/2).
+size_t slotCount(size_t entryCount)
+{
+    size_t n = 16;
+    while ( n < 2 * entryCount )
+        n *= 2;
+    return n;
+}
+
+uint64_t pathHash(std::string_view path)
+{
+    const uint64_t h = hash128(path.data(), path.size()).low;
+    return h != 0 ? h : 1;
+}
+
+} // unnamed namespace
+
+size_t PathIndex::memoryUsage(size_t entryCount)
+{
+    return slotCount(entryCount) * sizeof(std::atomic<uint64_t>);
+}
+
+PathIndex::PathIndex(const zim::Archive& archive, WorkerPool& workerPool)
+    : entryCount(archive.getEntryCount())
+    , mask(slotCount(entryCount) - 1)
+    , slots(new std::atomic<uint64_t>[mask + 1])
+{
+    for ( size_t i = 0; i <= mask; ++i )
+        slots[i].store(0, std::memory_order_relaxed);
+
+    workerPool.forEachRange(entryCount, 4096, [this, &archive](size_t begin, size_t end) {
+        for ( size_t i = begin; i < end; ++i ) {
+            const auto entry = archive.getEntryByPath(zim::entry_index_type(i));
+            insert(pathHash(entry.getPath()));
+        }
+    });
+}
+
+void PathIndex::insert(uint64_t hash)
+{
+    for ( size_t i = hash & mask; ; i = (i + 1) & mask ) {
+        uint64_t expected = 0;
+        if ( slots[i].compare_exchange_strong(expected, hash, std::memory_order_relaxed) )
+            return;
+        if ( expected == hash )
+            return;
+    }
+}
+
+bool PathIndex::contains(std::string_view path) const
+{
+    const uint64_t hash = pathHash(path);
+    for ( size_t i = hash & mask; ; i = (i + 1) & mask ) {
+        const uint64_t h = slots[i].load(std::memory_order_relaxed);
+        if ( h == hash )
+            return true;
+        if ( h == 0 )
+            return false;
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_PATH_INDEX_H_
+#define _ZIM_TOOL_PATH_INDEX_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace zim {
+  class Archive;
+}
+
+class WorkerPool;
+
+// In-memory set of the paths of all the entries of an archive.
+//
+// Only 64-bit hashes of the paths are stored (in an open addressing hash
+// table with linear probing). The probability of a false positive is thus
+// negligible (about one in 2^64/entryCount for a path that doesn't exist).
+//
+// The index is built in parallel (on the workers of a pool). Once built, it is read-only and can be
+// queried concurrently without any locking.
+class PathIndex
+{
+  public: // functions
+    // Builds the index of the paths of the entries in iterByPath() order.
+    PathIndex(const zim::Archive& archive, WorkerPool& workerPool);
+
+    // Memory needed by the index of an archive with entryCount entries.
+    static size_t memoryUsage(size_t entryCount);
+
+    bool contains(std::string_view path) const;
+
+    size_t size() const { return entryCount; }
+    size_t memoryUsage() const { return memoryUsage(entryCount); }
+
+  private: // functions
+    void insert(uint64_t hash);
+
+  private: // data
+    const size_t entryCount;
+    const size_t mask;
+
+    // 0 marks an empty slot
+    std::unique_ptr<std::atomic<uint64_t>[]> slots;
+};
+
+#endif // _ZIM_TOOL_PATH_INDEX_H_
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+void WorkerPool::TaskQueue::push(Task&& task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+}
+
+bool WorkerPool::TaskQueue::popFront(Task& task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( tasks.empty() )
+        return false;
+    task = std::move(tasks.front());
+    tasks.pop_front();
+    return true;
+}
+
+bool WorkerPool::TaskQueue::stealBack(Task& task)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( tasks.empty() )
+        return false;
+    task = std::move(tasks.back());
+    tasks.pop_back();
+    return true;
+}
+
+WorkerPool::WorkerPool(unsigned threadCount)
+    : queues(std::max(threadCount, 1U))
+{
+    for ( size_t i = 0; i < queues.size(); ++i )
+        threads.emplace_back([this, i]() { this->processTasks(i); });
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        terminating = true;
+    }
+    workersCV.notify_all();
+
+    for ( auto& t : threads )
+        t.join();
+}
+
+void WorkerPool::submit(Task task)
+{
+    size_t queueIndex;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queueIndex = nextQueue;
+        nextQueue = (nextQueue + 1) % queues.size();
+        ++queuedTaskCount;
+    }
+
+    queues[queueIndex].push(std::move(task));
+    workersCV.notify_one();
+}
+
+bool WorkerPool::takeTask(size_t workerIndex, Task& task)
+{
+    bool found = queues[workerIndex].popFront(task);
+    for ( size_t i = 1; !found && i < queues.size(); ++i ) {
+        found = queues[(workerIndex + i) % queues.size()].stealBack(task);
+    }
+
+    if ( found ) {
+        std::lock_guard<std::mutex> lock(mutex);
+        --queuedTaskCount;
+    }
+    return found;
+}
+
+void WorkerPool::processTasks(size_t workerIndex)
+{
+    Task task;
+    while ( true )
+    {
+        if ( takeTask(workerIndex, task) ) {
+            task(workerIndex);
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if ( queuedTaskCount == 0 && terminating )
+            break;
+        workersCV.wait(lock, [this]() {
+            return queuedTaskCount != 0 || terminating;
+        });
+    }
+}
+
+namespace
+{
+
+// Ranges of a WorkerPool::forEachRange() call, claimed one by one by the
+// calling thread and the workers
+struct RangeProgress
+{
+    std::atomic<size_t> nextChunk{0};
+
+    // The count of the chunks not yet processed (or skipped) and the first
+    // error are protected by mutex
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t pendingChunks = 0;
+    std::exception_ptr error;
+};
+
+} // unnamed namespace
+
+void WorkerPool::forEachRange(size_t count, size_t chunkSize, const RangeTask& f)
+{
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if ( chunkCount == 0 )
+        return;
+
+    const auto progress = std::make_shared<RangeProgress>();
+    progress->pendingChunks = chunkCount;
+
+    // f is accessed only while a chunk is pending, hence before this
+    // function returns. A worker coming late finds no chunk left.
+    const auto work = [progress, count, chunkSize, chunkCount, &f]() {
+        size_t chunk;
+        while ( (chunk = progress->nextChunk++) < chunkCount ) {
+            std::exception_ptr error;
+            bool skip;
+            {
+                std::lock_guard<std::mutex> lock(progress->mutex);
+                skip = bool(progress->error);
+            }
+            if ( !skip ) {
+                try {
+                    const size_t begin = chunk * chunkSize;
+                    f(begin, std::min(begin + chunkSize, count));
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(progress->mutex);
+            if ( error && !progress->error )
+                progress->error = error;
+            if ( --progress->pendingChunks == 0 )
+                progress->cv.notify_all();
+        }
+    };
+
+    const size_t helperCount = std::min(size(), chunkCount - 1);
+    for ( size_t i = 0; i < helperCount; ++i )
+        submit([work](size_t) { work(); });
+    work();
+
+    std::unique_lock<std::mutex> lock(progress->mutex);
+    progress->cv.wait(lock, [&progress]() { return progress->pendingChunks == 0; });
+    if ( progress->error )
+        std::rethrow_exception(progress->error);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 Kiwix
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU  General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef _ZIM_TOOL_WORKER_POOL_H_
+#define _ZIM_TOOL_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of worker threads with work stealing.
+//
+// Every worker owns a queue of tasks; submitted tasks are distributed
+// (round-robin) over the queues. A worker takes tasks from the front of its
+// own queue and, once it runs out of work, steals tasks from the back of the
+// queues of the other workers.
+//
+// Tasks can be submitted concurrently from any thread (the pool may be
+// shared by the checks of several ZIM files). A task receives the index of
+// the worker running it, so that it can use per-worker state without
+// locking. Tasks must not throw.
+class WorkerPool
+{
+public: // types
+    typedef std::function<void(size_t workerIndex)> Task;
+    typedef std::function<void(size_t begin, size_t end)> RangeTask;
+
+public: // functions
+    explicit WorkerPool(unsigned threadCount);
+
+    // Completes all submitted tasks and terminates the worker threads
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return queues.size(); }
+
+    void submit(Task task);
+
+    // Calls f() on the consecutive ranges of [0, count) of chunkSize items
+    // (the last one may be shorter), in parallel on the workers and on the
+    // calling thread, and returns once all the ranges are processed. The
+    // calling thread takes part in the work, so that it doesn't wait for
+    // workers busy with other tasks (it can even be a worker itself). The
+    // first exception thrown by f() is rethrown, the ranges not processed yet
+    // being then skipped.
+    void forEachRange(size_t count, size_t chunkSize, const RangeTask& f);
+
+private: // types
+    // Double ended queue of tasks owned by one worker thread
+    class TaskQueue
+    {
+    public: // functions
+        void push(Task&& task);
+        bool popFront(Task& task);
+        bool stealBack(Task& task);
+
+    private: // data
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+private: // functions
+    bool takeTask(size_t workerIndex, Task& task);
+    void processTasks(size_t workerIndex);
+
+private: // data
+    std::vector<TaskQueue> queues;
+    std::vector<std::thread> threads;
+
+    // The count of tasks sitting in the queues (i.e. submitted but not yet
+    // taken by a worker), the queue receiving the next task and the
+    // termination flag are protected by mutex. Idle workers wait on
+    // workersCV.
+    std::mutex mutex;
+    std::condition_variable workersCV;
+    size_t queuedTaskCount = 0;
+    size_t nextQueue = 0;
+    bool terminating = false;
+};
+
+#endif // _ZIM_TOOL_WORKER_POOL_H_
@@ -32,8 +32,12 @@
 #include <regex>
 #include <ctime>
 #include <unordered_map>
+#include <climits>
 #include <cmath>
-#include <iostream>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -43,12 +47,18 @@
 #include "../version.h"
 #include "../tools.h"
 #include "checks.h"
+#include "check_scheduler.h"
+#include "worker_pool.h"
 
 static const char USAGE[] =
 R"(Zimcheck checks the quality of a ZIM file.
 
 Usage:
-  zimcheck [options] [ZIMFILE]
+  zimcheck [options] [ZIMFILE...]
+
+Several ZIM files are checked concurrently, sharing the same threads. The
+report of each file is then output in one piece (on a single line in JSON
+format).
 
 Options:
  -A --all             run all tests. Default if no flags are given.
@@ -59,21 +69,37 @@ Options:
  -F --favicon         Favicon
  -P --main            Main page
  -R --redundant       Redundant data check
+    --verify_redundant  Compare byte by byte the content of redundant items
  -U --url_internal    URL check - Internal URLs
  -X --url_external    URL check - External URLs
  -D --details         Details of error
  -B --progress        Print progress report
+ --progress_fd=<fd>   write the progress as NDJSON records to the given file descriptor
+ --progress-fd=<fd>   same as --progress_fd (as spelled by zimrecreate and zimwriterfs)
  -J --json            Output in JSON format
+ --ndjson             Output in NDJSON format (a line per message, as soon as found, then a summary line)
  -H --help            Displays Help
  -V --version         Displays software version
  -L --redirect_loop   Checks for the existence of redirect loops
  -W=<nb_thread> --threads=<nb_thread>  count of threads to utilize [default: 1]
+ --path_index_max_mb=<mb>  memory limit of the index of entry paths used by the internal URL check [default: 512]
+ --link_table_max_mb=<mb>  memory limit of the table of the distinct internal links, each of which is resolved once [default: 512]
+ --max_memory=<mb>    memory budget of the checks of a ZIM file, beyond which temporary files are used
+ --file_list=<path>   check the ZIM files listed (one per line) in the given file
+ --sample=<fraction>  check the articles of a random sample of the clusters only (fraction between 0 and 1), and estimate the error rate of the whole file
+ --time_budget=<seconds>  stop checking the articles after the given time, checking the clusters in random order
+ --cluster_cache=<path>  reuse (and update) the results of the article checks of the clusters unchanged since a previous check of the ZIM file
+ --profile            add the timings and counters of the checks to the JSON output
+ --link_graph=<path>  write the graph of the internal links to the given file, and report the orphan pages and those unreachable from the main page
 
 Examples:
  zimcheck -A wikipedia.zim
  zimcheck --checksum --redundant wikipedia.zim
  zimcheck -F -R wikipedia.zim
- zimcheck -M --favicon wikipedia.zim)";
+ zimcheck -M --favicon wikipedia.zim
+ zimcheck -J -W 8 --file_list=zimfiles.txt
+ zimcheck -U -X --sample=0.01 --time_budget=600 wikipedia.zim
+ zimcheck -A --cluster_cache=wikipedia.cache wikipedia.zim)";
 
 
 // Older version of docopt doesn't define Options
@@ -115,27 +141,419 @@ int zimcheck(const std::vector<const char*>& args) {
     return zimcheck(parsed_args);
 }
 
-int zimcheck(const Options& args)
+namespace
+{
+
+// Settings of the checks, as given on the command line
+struct CheckSettings
+{
+    EnabledTests enabled_tests;
+    bool error_details = false;
+    OutputFormat format = OutputFormat::TEXT;
+    bool progress = false;
+    int progress_fd = -1;
+    ArticleCheckOptions article_check_options;
+};
+
+// Reads the paths of the ZIM files listed (one per line) in a text file
+std::vector<std::string> readFileList(const std::string& path)
+{
+    std::ifstream in(path);
+    if ( !in ) {
+        throw std::runtime_error("Cannot open the file list " + path);
+    }
+
+    std::vector<std::string> filenames;
+    std::string line;
+    while ( std::getline(in, line) ) {
+        if ( !line.empty() && line.back() == '\r' ) {
+            line.pop_back();
+        }
+        if ( !line.empty() ) {
+            filenames.push_back(line);
+        }
+    }
+    return filenames;
+}
+
+// Parses the value of a numeric option, which must be in the given range
+double parseOptionValue(const std::string& option, const std::string& value,
+                        double min, double max)
+{
+    size_t pos = 0;
+    double result = 0;
+    try {
+        result = std::stod(value, &pos);
+    } catch (const std::exception&) {
+        pos = 0;
+    }
+    if ( pos == 0 || pos != value.size() || !(result > min && result <= max) ) {
+        throw std::runtime_error("Invalid value of " + option + ": " + value);
+    }
+    return result;
+}
+
+// Parses the value of an option giving a memory size in MB (possibly 0)
+size_t parseMegabytesOptionValue(const std::string& option, const std::string& value)
+{
+    const double mb = parseOptionValue(option, value, -1, double(SIZE_MAX >> 20));
+    if ( mb != std::floor(mb) ) {
+        throw std::runtime_error("Invalid value of " + option + ": " + value);
+    }
+    return size_t(mb);
+}
+
+// Timings and counters of the checks of a ZIM file (see --profile)
+struct Profile
+{
+    // Wall-clock time of every check. The checks running concurrently,
+    // their times may overlap.
+    std::vector<std::pair<std::string, double>> checkTimes;
+
+    ArticleCheckProfile articles;
+};
+
+JSON::OutputStream& operator<<(JSON::OutputStream& out, const Profile& profile)
+{
+    out << JSON::startObject;
+    out << JSON::property("checks", JSON::startObject);
+    for ( const auto& t : profile.checkTimes ) {
+        out << JSON::property(t.first + "_seconds", t.second);
+    }
+    out << JSON::endObject;
+    out << JSON::property("articles", profile.articles);
+    out << JSON::endObject;
+    return out;
+}
+
+// Records the time of the check in the profile (if any)
+CheckScheduler::Check timed(Profile* profile, const std::string& name, CheckScheduler::Check check)
+{
+    if ( !profile )
+        return check;
+
+    const size_t i = profile->checkTimes.size();
+    profile->checkTimes.emplace_back(name, 0.0);
+    return [profile, i, check](ErrorLogger& reporter) {
+        const auto start = std::chrono::steady_clock::now();
+        const bool result = check(reporter);
+        const std::chrono::duration<double> time(std::chrono::steady_clock::now() - start);
+        profile->checkTimes[i].second = time.count();
+        return result;
+    };
+}
+
+uint64_t getFileSize(const std::string& filename)
+{
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    const auto size = in.tellg();
+    return in && size > 0 ? uint64_t(size) : 0;
+}
+
+StatusCode checkZimFile(const std::string& filename, const CheckSettings& settings,
+                        ErrorLogger& error, ProgressBar& progress)
 {
     // To calculate the total time taken by the program to run.
     const auto starttime = std::chrono::steady_clock::now();
 
+    const EnabledTests& enabled_tests = settings.enabled_tests;
+    StatusCode status_code = PASS;
+
+    error.setFileName(filename);
+    if ( settings.article_check_options.max_memory_mb != 0 ) {
+        // An eighth of the budget for the messages waiting for the report
+        error.setMemoryLimit(settings.article_check_options.max_memory_mb * 1024 * 1024 / 8);
+    }
+    progress.set_progress_fd(settings.progress_fd, filename);
+    error.addInfo("zimcheck_version", std::string(VERSION));
+    error.addInfo("checks", enabled_tests);
+    error.addInfo("file_name",  filename);
+    error.infoMsg("[INFO] Checking zim file " + filename);
+    error.infoMsg("[INFO] Zimcheck version is " + std::string(VERSION));
+
+    std::unique_ptr<Profile> profile;
+    if ( settings.article_check_options.profile ) {
+        profile.reset(new Profile);
+    }
+
+    // The checks are run concurrently, as allowed by their dependencies
+    CheckScheduler scheduler(error);
+
+    //Test 0: Low-level ZIM-file structure integrity checks
+    //The content of the file is read only after the validation of its
+    //structure. The validation of the checksum (which reads the whole file)
+    //runs concurrently with the other checks, whose results are discarded
+    //if it fails.
+    std::vector<CheckScheduler::CheckId> integrity, checksum;
+    if(enabled_tests.isEnabled(TestType::INTEGRITY)) {
+        integrity.push_back(scheduler.add(timed(profile.get(), "integrity", [&](ErrorLogger& r) {
+            return test_integrity_structure(filename, r);
+        })));
+        checksum.push_back(scheduler.add(timed(profile.get(), "integrity_checksum", [&](ErrorLogger& r) {
+            return test_integrity_checksum(filename, r);
+        }), {}, integrity));
+    } else {
+        error.infoMsg("[WARNING] Integrity check is skipped. Any detected errors may in fact be due to corrupted/invalid data.");
+    }
+
+    std::unique_ptr<zim::Archive> archive;
+    const auto openArchive = scheduler.add(timed(profile.get(), "open", [&](ErrorLogger&) {
+        archive.reset(new zim::Archive(filename));
+        return true;
+    }), integrity, checksum);
+
+    // The long checks of the content stop as soon as the checksum is found
+    // invalid, their results being discarded
+    const std::atomic<bool>& cancellation = scheduler.cancellation(openArchive);
+    ArticleCheckOptions articleCheckOptions = settings.article_check_options;
+    articleCheckOptions.cancellation = &cancellation;
+    // All the parallel work on the file (article checks, index of the
+    // paths, redirection loops and link graph) is done by the same pool
+    std::unique_ptr<WorkerPool> ownWorkerPool;
+    if ( !articleCheckOptions.worker_pool ) {
+        ownWorkerPool = std::make_unique<WorkerPool>(std::max(articleCheckOptions.thread_count, 1));
+        articleCheckOptions.worker_pool = ownWorkerPool.get();
+    }
+
+    //Test 1: Internal Checksum
+    //The checksum is verified in one sequential pass over the file, which
+    //runs concurrently with the other checks.
+    if(enabled_tests.isEnabled(TestType::CHECKSUM)) {
+        if ( enabled_tests.isEnabled(TestType::INTEGRITY) ) {
+            scheduler.add([&](ErrorLogger& r) {
+                r.infoMsg(
+                    "[INFO] Avoiding redundant checksum test"
+                    " (already performed by the integrity check)."
+                );
+                return true;
+            }, {openArchive});
+        } else {
+            scheduler.add(timed(profile.get(), "checksum", [&](ErrorLogger& r) {
+                test_checksum(filename, r);
+                return true;
+            }));
+        }
+    }
+
+    //Test 2: Metadata Entries:
+    //The file is searched for the compulsory metadata entries.
+    if(enabled_tests.isEnabled(TestType::METADATA)) {
+        scheduler.add(timed(profile.get(), "metadata", [&](ErrorLogger& r) {
+            test_metadata(*archive, r);
+            return true;
+        }), {openArchive});
+    }
+
+    //Test 3: Test for Favicon.
+    if(enabled_tests.isEnabled(TestType::FAVICON)) {
+        scheduler.add(timed(profile.get(), "favicon", [&](ErrorLogger& r) {
+            test_favicon(*archive, r);
+            return true;
+        }), {openArchive});
+    }
+
+    //Test 4: Main Page Entry
+    if(enabled_tests.isEnabled(TestType::MAIN_PAGE)) {
+        scheduler.add(timed(profile.get(), "main_page", [&](ErrorLogger& r) {
+            test_mainpage(*archive, r);
+            return true;
+        }), {openArchive});
+    }
+
+    std::vector<CheckScheduler::CheckId> articleChecks;
+    ArticleCheckStats articleCheckStats;
+
+    /* Now we want to avoid to loop on the tests but on the article.
+     *
+     * If we loop of the tests we will have :
+     *
+     * for (test: tests) {
+     *     for(article: articles) {
+     *          data = article->getData();
+     *          ...
+     *     }
+     * }
+     *
+     * And so we will get several the data of an article (and so decompression and so).
+     * By looping on the articles first, we have :
+     *
+     * for (article: articles) {
+     *     data = article->getData();
+     *     for (test: tests) {
+     *         ...
+     *     }
+     * }
+     */
+
+    if ( enabled_tests.isEnabled(TestType::URL_INTERNAL) ||
+         enabled_tests.isEnabled(TestType::URL_EXTERNAL) ||
+         enabled_tests.isEnabled(TestType::REDUNDANT) ||
+         enabled_tests.isEnabled(TestType::EMPTY) ) {
+        articleChecks.push_back(scheduler.add(timed(profile.get(), "articles", [&](ErrorLogger& r) {
+            articleCheckStats = test_articles(*archive, r, progress, enabled_tests, articleCheckOptions);
+            return true;
+        }), {openArchive}));
+    }
+
+    if ( enabled_tests.isEnabled(TestType::REDIRECT)) {
+        scheduler.add(timed(profile.get(), "redirect_loop", [&](ErrorLogger& r) {
+            test_redirect_loop(*archive, r, articleCheckOptions.worker_pool, &cancellation);
+            return true;
+        }), {openArchive});
+    }
+
+    scheduler.run();
+    if ( scheduler.passed(openArchive) ) {
+        error.addInfo("file_uuid",  stringify(archive->getUuid()));
+    }
+    if ( settings.article_check_options.sampled() && !articleChecks.empty()
+         && scheduler.passed(articleChecks[0]) ) {
+        error.addInfo("sample", articleCheckStats);
+    }
+    if ( !settings.article_check_options.link_graph.empty() && !articleChecks.empty()
+         && scheduler.passed(articleChecks[0]) ) {
+        error.addInfo("link_graph", articleCheckStats.link_graph);
+    }
+    if ( profile ) {
+        if ( !articleChecks.empty() && scheduler.passed(articleChecks[0]) ) {
+            profile->articles = articleCheckStats.profile;
+        }
+        error.addInfo("profile", *profile);
+    }
+
+    const bool overallStatus = error.overallStatus();
+    error.addInfo("status", overallStatus);
+    error.report(settings.error_details);
+    if( overallStatus )
+    {
+        error.infoMsg("[INFO] Overall Test Status: Pass");
+        status_code = PASS;
+    }
+    else
+    {
+        error.infoMsg("[INFO] Overall Test Status: Fail");
+        status_code = FAIL;
+    }
+
+    const auto endtime = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> runtime(endtime - starttime);
+    const long seconds = lround(runtime.count());
+    std::ostringstream ss;
+    ss << "[INFO] Total time taken by zimcheck: ";
+    if ( seconds < 3 )
+    {
+      ss << "<3";
+    }
+    else
+    {
+      ss << seconds;
+    }
+    ss << " seconds.";
+    error.infoMsg(ss.str());
+
+    return status_code;
+}
+
+// Checks several ZIM files concurrently.
+//
+// The article checks of all the files are run by the same pool of threads.
+// The files are taken largest first, so that the small ones fill the gaps
+// left at the end by the big ones. The report of a file is buffered and
+// output in one piece once the file is checked (except in NDJSON format).
+int checkZimFiles(const std::vector<std::string>& filenames, CheckSettings settings)
+{
+    // The JSON document of every file takes a single line
+    if ( settings.format == OutputFormat::JSON )
+        settings.format = OutputFormat::COMPACT_JSON;
+    // In NDJSON format the messages are output as soon as they are found
+    const bool buffered = settings.format != OutputFormat::NDJSON;
+
+    const unsigned threadCount = std::max(settings.article_check_options.thread_count, 1);
+    WorkerPool workerPool(threadCount);
+    settings.article_check_options.worker_pool = &workerPool;
+
+    std::vector<std::pair<uint64_t, std::string>> files;
+    for ( const auto& filename : filenames ) {
+        files.emplace_back(getFileSize(filename), filename);
+    }
+
+    // The memory budget is shared by the files checked simultaneously
+    const size_t fileThreadCount = std::min<size_t>(threadCount, files.size());
+    size_t& maxMemory = settings.article_check_options.max_memory_mb;
+    if ( maxMemory != 0 ) {
+        maxMemory = std::max<size_t>(maxMemory / fileThreadCount, 1);
+    }
+    std::stable_sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+        return a.first > b.first;
+    });
+
+    std::mutex mutex;
+    size_t nextFile = 0;
+    int status_code = PASS;
+    const auto checkFiles = [&]() {
+        while ( true ) {
+            std::string filename;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if ( nextFile == files.size() )
+                    return;
+                filename = files[nextFile++].second;
+            }
+
+            std::ostringstream report;
+            std::string errorMsg;
+            StatusCode file_status_code;
+            {
+                ErrorLogger error(settings.format, buffered ? report : std::cout);
+                ProgressBar progress(1);
+                try {
+                    file_status_code = checkZimFile(filename, settings, error, progress);
+                } catch (const std::exception & e) {
+                    errorMsg = e.what();
+                    error.addInfo("error", errorMsg);
+                    file_status_code = EXCEPTION;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if ( !errorMsg.empty() ) {
+                std::cerr << filename << ": " << errorMsg << std::endl;
+            }
+            std::cout << report.str() << std::flush;
+            status_code = std::max(status_code, int(file_status_code));
+        }
+    };
+
+    // Every file is checked by its own thread, while the pool runs the
+    // article checks. The count of files processed simultaneously is limited
+    // to the count of threads in order to bound the memory usage.
+    std::vector<std::thread> threads;
+    for ( size_t i = 0; i < fileThreadCount; ++i ) {
+        threads.emplace_back(checkFiles);
+    }
+    for ( auto& t : threads ) {
+        t.join();
+    }
+    return status_code;
+}
+
+} // unnamed namespace
+
+int zimcheck(const Options& args)
+{
     // The boolean values which will be used to store the output from
     // getopt_long().  These boolean values will be then read by the
     // program to execute the different parts of the program.
 
     bool run_all = false;
-    EnabledTests enabled_tests;
-    bool error_details = false;
+    CheckSettings settings;
+    EnabledTests& enabled_tests = settings.enabled_tests;
+    ArticleCheckOptions& article_check_options = settings.article_check_options;
     bool no_args = true;
-    bool json = false;
-    int thread_count = 1;
 
-    std::string filename = "";
-    ProgressBar progress(1);
+    std::vector<std::string> filenames;
+    bool file_list = false;
 
-    StatusCode status_code = PASS;
-    
     for(auto const& arg: args) {
         if (arg.first == "--all" && arg.second.asBool()) {
             run_all = true;
@@ -156,7 +574,18 @@ int zimcheck(const Options& args)
             enabled_tests.enable(TestType::METADATA);
             no_args = false;
         } else if (arg.first == "--progress") {
-            progress.set_progress_report(arg.second.asBool());
+            settings.progress = arg.second.asBool();
+        } else if ((arg.first == "--progress_fd" || arg.first == "--progress-fd") && arg.second.isString()) {
+            try {
+                const double fd = parseOptionValue(arg.first, arg.second.asString(), -1, INT_MAX);
+                if ( fd != std::floor(fd) ) {
+                    throw std::runtime_error("Invalid value of " + arg.first + ": " + arg.second.asString());
+                }
+                settings.progress_fd = int(fd);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
         } else if (arg.first == "--favicon" && arg.second.asBool()) {
             enabled_tests.enable(TestType::FAVICON);
             no_args = false;
@@ -166,6 +595,8 @@ int zimcheck(const Options& args)
         } else if (arg.first == "--redundant" && arg.second.asBool()) {
             enabled_tests.enable(TestType::REDUNDANT);
             no_args = false;
+        } else if (arg.first == "--verify_redundant") {
+            article_check_options.verify_redundant = arg.second.asBool();
         } else if (arg.first == "--url_internal" && arg.second.asBool()) {
             enabled_tests.enable(TestType::URL_INTERNAL);
             no_args = false;
@@ -176,20 +607,77 @@ int zimcheck(const Options& args)
             enabled_tests.enable(TestType::REDIRECT);
             no_args = false;
         } else if (arg.first == "--details") {
-            error_details = arg.second.asBool();
-        } else if (arg.first == "--json") {
-            json = arg.second.asBool();
+            settings.error_details = arg.second.asBool();
+        } else if (arg.first == "--json" && arg.second.asBool()) {
+            settings.format = OutputFormat::JSON;
+        } else if (arg.first == "--ndjson" && arg.second.asBool()) {
+            settings.format = OutputFormat::NDJSON;
         } else if (arg.first == "--threads") {
-            thread_count = arg.second.asLong();
-        } else if (arg.first == "ZIMFILE" && arg.second.isString()) {
-            filename = arg.second.asString();
+            article_check_options.thread_count = arg.second.asLong();
+        } else if (arg.first == "--path_index_max_mb" && arg.second.isString()) {
+            try {
+                article_check_options.path_index_max_mb = parseMegabytesOptionValue("--path_index_max_mb", arg.second.asString());
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
+        } else if (arg.first == "--link_table_max_mb" && arg.second.isString()) {
+            try {
+                article_check_options.link_table_max_mb = parseMegabytesOptionValue("--link_table_max_mb", arg.second.asString());
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
+        } else if (arg.first == "--max_memory" && arg.second.isString()) {
+            try {
+                const double mb = parseOptionValue("--max_memory", arg.second.asString(), 0, double(SIZE_MAX >> 20));
+                if ( mb != std::floor(mb) ) {
+                    throw std::runtime_error("Invalid value of --max_memory: " + arg.second.asString());
+                }
+                article_check_options.max_memory_mb = size_t(mb);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
+        } else if (arg.first == "--sample" && arg.second.isString()) {
+            try {
+                article_check_options.sample_fraction = parseOptionValue("--sample", arg.second.asString(), 0, 1);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
+        } else if (arg.first == "--time_budget" && arg.second.isString()) {
+            try {
+                article_check_options.time_budget = parseOptionValue("--time_budget", arg.second.asString(), 0, HUGE_VAL);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
+        } else if (arg.first == "--profile") {
+            article_check_options.profile = arg.second.asBool();
+        } else if (arg.first == "--cluster_cache" && arg.second.isString()) {
+            article_check_options.cluster_cache = arg.second.asString();
+        } else if (arg.first == "--link_graph" && arg.second.isString()) {
+            article_check_options.link_graph = arg.second.asString();
+        } else if (arg.first == "--file_list" && arg.second.isString()) {
+            try {
+                const auto listedFiles = readFileList(arg.second.asString());
+                filenames.insert(filenames.end(), listedFiles.begin(), listedFiles.end());
+                file_list = true;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return -1;
+            }
+        } else if (arg.first == "ZIMFILE" && arg.second.isStringList()) {
+            const auto& zimfiles = arg.second.asStringList();
+            filenames.insert(filenames.end(), zimfiles.begin(), zimfiles.end());
         } else if (arg.first == "--version" && arg.second.asBool()) {
             printVersions();
             return 0;
         }
     }
-    
-    if (filename.empty()) {
+
+    if (filenames.empty()) {
         std::cerr << "No file provided as argument" << std::endl;
         std::cout << USAGE << std::endl;
         return -1;
@@ -201,116 +689,42 @@ int zimcheck(const Options& args)
         enabled_tests.enableAll();
     }
 
-    ErrorLogger error(json);
-    error.addInfo("zimcheck_version", std::string(VERSION));
-    //Tests.
-    try
-    {
-        error.addInfo("checks", enabled_tests);
-        error.addInfo("file_name",  filename);
-        error.infoMsg("[INFO] Checking zim file " + filename);
-        error.infoMsg("[INFO] Zimcheck version is " + std::string(VERSION));
-
-        //Test 0: Low-level ZIM-file structure integrity checks
-        bool should_run_full_test = true;
-        if(enabled_tests.isEnabled(TestType::INTEGRITY)) {
-            should_run_full_test = test_integrity(filename, error);
-        } else {
-            error.infoMsg("[WARNING] Integrity check is skipped. Any detected errors may in fact be due to corrupted/invalid data.");
+    if ( !article_check_options.link_graph.empty() ) {
+        if ( !enabled_tests.isEnabled(TestType::URL_INTERNAL) ) {
+            std::cerr << "--link_graph requires the internal URL check" << std::endl;
+            return -1;
         }
-
-
-        if (should_run_full_test) {
-            zim::Archive archive( filename );
-            error.addInfo("file_uuid",  stringify(archive.getUuid()));
-
-            //Test 1: Internal Checksum
-            if(enabled_tests.isEnabled(TestType::CHECKSUM)) {
-                if ( enabled_tests.isEnabled(TestType::INTEGRITY) ) {
-                    error.infoMsg(
-                        "[INFO] Avoiding redundant checksum test"
-                        " (already performed by the integrity check)."
-                    );
-                } else {
-                    test_checksum(archive, error);
-                }
-            }
-
-            //Test 2: Metadata Entries:
-            //The file is searched for the compulsory metadata entries.
-            if(enabled_tests.isEnabled(TestType::METADATA))
-                test_metadata(archive, error);
-
-            //Test 3: Test for Favicon.
-            if(enabled_tests.isEnabled(TestType::FAVICON))
-                test_favicon(archive, error);
-
-
-            //Test 4: Main Page Entry
-            if(enabled_tests.isEnabled(TestType::MAIN_PAGE))
-                test_mainpage(archive, error);
-
-            /* Now we want to avoid to loop on the tests but on the article.
-             *
-             * If we loop of the tests we will have :
-             *
-             * for (test: tests) {
-             *     for(article: articles) {
-             *          data = article->getData();
-             *          ...
-             *     }
-             * }
-             *
-             * And so we will get several the data of an article (and so decompression and so).
-             * By looping on the articles first, we have :
-             *
-             * for (article: articles) {
-             *     data = article->getData();
-             *     for (test: tests) {
-             *         ...
-             *     }
-             * }
-             */
-
-            if ( enabled_tests.isEnabled(TestType::URL_INTERNAL) ||
-                 enabled_tests.isEnabled(TestType::URL_EXTERNAL) ||
-                 enabled_tests.isEnabled(TestType::REDUNDANT) ||
-                 enabled_tests.isEnabled(TestType::EMPTY) )
-              test_articles(archive, error, progress, enabled_tests, thread_count);
-
-            if ( enabled_tests.isEnabled(TestType::REDIRECT))
-                test_redirect_loop(archive, error);
+        if ( article_check_options.sampled() ) {
+            std::cerr << "--link_graph cannot be used with --sample or --time_budget" << std::endl;
+            return -1;
         }
+    }
 
-        const bool overallStatus = error.overallStatus();
-        error.addInfo("status", overallStatus);
-        error.report(error_details);
-        if( overallStatus )
-        {
-            error.infoMsg("[INFO] Overall Test Status: Pass");
-            status_code = PASS;
-        }
-        else
-        {
-            error.infoMsg("[INFO] Overall Test Status: Fail");
-            status_code = FAIL;
+    if ( filenames.size() > 1 || file_list ) {
+        if ( !article_check_options.cluster_cache.empty() ) {
+            std::cerr << "--cluster_cache can be used with a single ZIM file only" << std::endl;
+            return -1;
         }
-
-        const auto endtime = std::chrono::steady_clock::now();
-        const std::chrono::duration<double> runtime(endtime - starttime);
-        const long seconds = lround(runtime.count());
-        std::ostringstream ss;
-        ss << "[INFO] Total time taken by zimcheck: ";
-        if ( seconds < 3 )
-        {
-          ss << "<3";
+        if ( !article_check_options.link_graph.empty() ) {
+            std::cerr << "--link_graph can be used with a single ZIM file only" << std::endl;
+            return -1;
         }
-        else
-        {
-          ss << seconds;
+        // The progress lines of the files checked concurrently would
+        // overwrite each other, while the records of --progress_fd are named
+        if ( settings.progress ) {
+            std::cerr << "[WARNING] --progress is ignored when several ZIM files are checked,"
+                         " use --progress_fd instead" << std::endl;
         }
-        ss << " seconds.";
-        error.infoMsg(ss.str());
+        return checkZimFiles(filenames, settings);
+    }
+
+    StatusCode status_code = PASS;
+    ErrorLogger error(settings.format);
+    ProgressBar progress(1);
+    progress.set_progress_report(settings.progress);
+    try
+    {
+        status_code = checkZimFile(filenames[0], settings, error, progress);
     }
     catch (const std::exception & e)
     {
@@ -35,6 +35,7 @@
 
 #include "version.h"
 #include "tools.h"
+#include "cluster_pipeline.h"
 
 #include <fcntl.h>
 #ifdef _WIN32
@@ -302,53 +303,60 @@ void ZimDumper::dumpFiles(const std::string& directory, bool symlinkdump, std::f
 #endif
 
   std::vector<std::string> pathcache;
-  for (auto& entry:m_archive.iterEfficient()) {
-    const std::string path = entry.getPath();
-    std::string dir = "";
-    std::string filename = path;
-    auto position = path.find_last_of('/');
-    if (position != std::string::npos) {
-        dir = path.substr(0, position + 1);
-        filename = path.substr(position + 1);
-        if (find(pathcache.begin(), pathcache.end(), dir) == pathcache.end()) {
-            createdir(dir, directory);
-            pathcache.push_back(dir);
-        }
-
-    }
-
-    if ( filename.length() > 255 ) {
-        std::ostringstream sspostfix, sst;
-        sspostfix << (++truncatedFiles);
-        sst << filename.substr(0, 254-sspostfix.tellp()) << "~" << sspostfix.str();
-        filename = sst.str();
-    }
-
-    std::stringstream ss;
-    ss << dir << filename;
-    std::string relative_path = ss.str();
-    std::string full_path = directory + SEPARATOR + relative_path;
-
-    if (entry.isRedirect()) {
-        auto redirectItem = entry.getItem(true);
-        std::string redirectPath = redirectItem.getPath();
-        redirectPath = computeRelativePath(path, redirectPath);
-        if (symlinkdump == false && redirectItem.getMimetype() == "text/html") {
-            writeHttpRedirect(directory, relative_path, path, redirectPath);
-        } else {
+  // The content of the upcoming clusters is read (and decompressed) by
+  // helper threads while the current one is written out
+  ClusterPipeline pipeline(m_archive);
+  ClusterPipeline::Group group;
+  while (pipeline.next(group)) {
+    for (size_t i = 0; i < group.entries.size(); ++i) {
+      const auto& entry = group.entries[i];
+      const std::string path = entry.getPath();
+      std::string dir = "";
+      std::string filename = path;
+      auto position = path.find_last_of('/');
+      if (position != std::string::npos) {
+          dir = path.substr(0, position + 1);
+          filename = path.substr(position + 1);
+          if (find(pathcache.begin(), pathcache.end(), dir) == pathcache.end()) {
+              createdir(dir, directory);
+              pathcache.push_back(dir);
+          }
+
+      }
+
+      if ( filename.length() > 255 ) {
+          std::ostringstream sspostfix, sst;
+          sspostfix << (++truncatedFiles);
+          sst << filename.substr(0, 254-sspostfix.tellp()) << "~" << sspostfix.str();
+          filename = sst.str();
+      }
+
+      std::stringstream ss;
+      ss << dir << filename;
+      std::string relative_path = ss.str();
+      std::string full_path = directory + SEPARATOR + relative_path;
+
+      if (entry.isRedirect()) {
+          auto redirectItem = entry.getItem(true);
+          std::string redirectPath = redirectItem.getPath();
+          redirectPath = computeRelativePath(path, redirectPath);
+          if (symlinkdump == false && redirectItem.getMimetype() == "text/html") {
+              writeHttpRedirect(directory, relative_path, path, redirectPath);
+          } else {
 #ifdef _WIN32
-            auto blob = redirectItem.getData();
-            write_to_file(directory + SEPARATOR, relative_path, blob.data(), blob.size());
+              auto blob = redirectItem.getData();
+              write_to_file(directory + SEPARATOR, relative_path, blob.data(), blob.size());
 #else
-            if (symlink(redirectPath.c_str(), full_path.c_str()) != 0) {
-              throw std::runtime_error(
-                std::string("Error creating symlink from ") + full_path + " to " + redirectPath);
-            }
+              if (symlink(redirectPath.c_str(), full_path.c_str()) != 0) {
+                throw std::runtime_error(
+                  std::string("Error creating symlink from ") + full_path + " to " + redirectPath);
+              }
 #endif
-        }
-    } else {
-      auto blob = entry.getItem().getData();
-      write_to_file(directory + SEPARATOR, relative_path, blob.data(), blob.size());
+          }
+      } else {
+        const auto& blob = group.blobs[i];
+        write_to_file(directory + SEPARATOR, relative_path, blob.data(), blob.size());
+      }
     }
   }
 }
@@ -28,6 +28,7 @@
 #include <algorithm>
 #include <sstream>
 
+#include "progress.h"
 #include "tools.h"
 #include "version.h"
 
@@ -96,7 +97,7 @@ class PatchItem : public zim::writer::Item
 };
 
 
-void create(const std::string& originFilename, const std::string& outFilename, bool withFtIndexFlag, unsigned long nbThreads)
+void create(const std::string& originFilename, const std::string& outFilename, bool withFtIndexFlag, unsigned long nbThreads, int progressFd)
 {
   zim::Archive origin(originFilename);
   zim::writer::Creator zimCreator;
@@ -136,7 +137,16 @@ void create(const std::string& originFilename, const std::string& outFilename, b
   }
 
 
+  ProgressBar progress(1);
+  progress.set_progress_fd(progressFd, outFilename);
+  progress.reset(origin.getEntryCount(), "entries");
+
   for(auto& entry:origin.iterEfficient()) {
+    progress.report();
+    if (!entry.isRedirect()) {
+      progress.addBytes(entry.getItem().getSize());
+    }
+
     if (fromNewNamespace) {
       //easy, just "copy" the item.
       if (entry.isRedirect()) {
@@ -167,6 +177,9 @@ void create(const std::string& originFilename, const std::string& outFilename, b
     }
 
   }
+  progress.finish();
+
+  progress.start("finalization");
   zimCreator.finishZimCreation();
 }
 
@@ -178,6 +191,8 @@ void usage()
     "\t-v, --version           print software version\n"
     "\t-j, --withoutFTIndex    don't create and add a fulltext index of the content to the ZIM\n"
     "\t-J, --threads <number>  count of threads to utilize (default: 4)\n"
+    "\t--progress-fd <fd>      write the progress as NDJSON records to the given file descriptor\n"
+    "\t                        (also accepted as --progress-fd=<fd>)\n"
     "\nReturn value:\n"
     "- 0 if no error\n"
     "- -1 if arguments are not valid\n"
@@ -189,6 +204,7 @@ int main(int argc, char* argv[])
 {
     bool withFtIndexFlag = true;
     unsigned long nbThreads = 4;
+    int progressFd = -1;
 
     //Parsing arguments
     //There will be only two arguments, so no detailed parsing is required.
@@ -235,6 +251,32 @@ int main(int argc, char* argv[])
                 return -1;
             }
         }
+
+        const std::string progressFdPrefix = "--progress-fd=";
+        if(std::string(argv[i])=="--progress-fd" ||
+           std::string(argv[i]).compare(0, progressFdPrefix.size(), progressFdPrefix)==0)
+        {
+            const std::string value = std::string(argv[i])=="--progress-fd"
+                                    ? (i+1 < argc ? argv[i+1] : "")
+                                    : std::string(argv[i]).substr(progressFdPrefix.size());
+            try
+            {
+                size_t pos = 0;
+                progressFd = std::stoi(value, &pos);
+                if(pos != value.size())
+                    progressFd = -1;
+            }
+            catch (...)
+            {
+                progressFd = -1;
+            }
+            if(progressFd < 0)
+            {
+                std::cerr << "The progress file descriptor should be a non-negative number" << std::endl;
+                usage();
+                return -1;
+            }
+        }
     }
 
     if(argc<3)
@@ -247,7 +289,7 @@ int main(int argc, char* argv[])
     std::string outputFilename = argv[2];
     try
     {
-        create(originFilename, outputFilename, withFtIndexFlag, nbThreads);
+        create(originFilename, outputFilename, withFtIndexFlag, nbThreads, progressFd);
     }
     catch (const std::exception& e)
     {
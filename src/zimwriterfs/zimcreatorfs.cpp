@@ -19,6 +19,7 @@
  */
 
 #include "zimcreatorfs.h"
+#include "../progress.h"
 #include "../tools.h"
 #include "tools.h"
 
@@ -180,6 +181,10 @@ void ZimCreatorFS::addFile(const std::string& path)
   if ( mimetype.find("text/html") != std::string::npos
     || mimetype.find("text/css") != std::string::npos) {
     auto content = getFileContent(path);
+    if (progress) {
+      progress->report();
+      progress->addBytes(content.size());
+    }
 
     if (mimetype.find("text/html") != std::string::npos) {
       hints[zim::writer::FRONT_ARTICLE] = 1;
@@ -196,6 +201,11 @@ void ZimCreatorFS::addFile(const std::string& path)
     item = zim::writer::StringItem::create(url, mimetype, title, hints, content);
   } else {
     item = std::make_shared<zim::writer::FileItem>(url, mimetype, title, hints, path);
+    if (progress) {
+      struct stat s;
+      progress->report();
+      progress->addBytes(stat(path.c_str(), &s) == 0 ? s.st_size : 0);
+    }
   }
   addItem(item);
 }
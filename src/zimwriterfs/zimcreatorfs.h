@@ -27,6 +27,8 @@
 
 #include <zim/writer/creator.h>
 
+class ProgressBar;
+
 class ZimCreatorFS : public zim::writer::Creator
 {
  public:
@@ -39,6 +41,8 @@ class ZimCreatorFS : public zim::writer::Creator
   virtual void addFile(const std::string& path);
 
   void processSymlink(const std::string& curdir, const std::string& symlink_path);
+  // Reports the added files (and their bytes) to progress, if set
+  void setProgress(ProgressBar* _progress) { progress = _progress; }
   const std::string & basedir() const { return directoryPath; }
   const std::string & canonicalBaseDir() const { return canonical_basedir; }
   std::string parseAndAdaptHtml(std::string& data, std::string& title, const std::string& url);
@@ -53,6 +57,7 @@ class ZimCreatorFS : public zim::writer::Creator
  private:
   std::string directoryPath;  ///< html dir without trailing slash
   std::string canonical_basedir;
+  ProgressBar* progress = nullptr;
 };
 
 struct Redirect {
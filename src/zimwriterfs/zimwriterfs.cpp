@@ -34,6 +34,7 @@
 
 #include "zimcreatorfs.h"
 #include "../metadata.h"
+#include "../progress.h"
 #include "../tools.h"
 #include "../version.h"
 #include "tools.h"
@@ -59,6 +60,7 @@ std::string directoryPath;
 
 
 int threads = 4;
+int progressFd = -1;
 zim::size_type clusterSize = 2048*1024;
 
 bool verboseFlag = false;
@@ -226,6 +228,8 @@ void usage()
             << std::endl;
   std::cout << "\t-s, --scraper\t\tname & version of tool used to produce HTML content"
             << std::endl;
+  std::cout << "\t--progress-fd\t\twrite the progress as NDJSON records to the given file descriptor"
+            << std::endl;
   std::cout << "\t--skip-libmagic-check\tAccept to run even if magic file cannot be loaded (mimetypes in the zim file may be wrong)." << std::endl;
   // --no-uuid and --dont-check-arguments are dev options, let's keep them secret
   // std::cout << "\t-U, --no-uuid\t\tdon't generate a random UUID" << std::endl;
@@ -275,6 +279,7 @@ void parse_args(int argc, char** argv)
          {"no-uuid", no_argument, 0, 'U'},
          {"dont-check-arguments", no_argument, 0, 'B'},
          {"skip-libmagic-check", no_argument, 0, 'M'},
+         {"progress-fd", required_argument, 0, 'P'},
 
          // Only for backward compatibility
          {"withFullTextIndex", no_argument, 0, 'i'},
@@ -366,6 +371,15 @@ void parse_args(int argc, char** argv)
         case 'M':
           continue_without_magic = true;
           break;
+        case 'P': {
+          char* end;
+          progressFd = strtol(optarg, &end, 10);
+          if (*optarg == '\0' || *end != '\0' || progressFd < 0) {
+            std::cerr << "zimwriterfs: invalid value of --progress-fd: " << optarg << std::endl;
+            exit(1);
+          }
+          break;
+        }
       }
     }
   } while (c != -1);
@@ -465,8 +479,14 @@ void create_zim(const zim::Metadata& metadata)
     zimCreator.setMainPath(welcome);
   }
 
+  ProgressBar progress(1);
+  progress.set_progress_fd(progressFd, zimPath);
+  zimCreator.setProgress(&progress);
+
   /* Directory visitor */
+  progress.start("files");
   zimCreator.visitDirectory(directoryPath);
+  progress.finish();
 
   /* Check redirects file and read it if necessary*/
   if (!redirectsPath.empty()) {
@@ -483,6 +503,7 @@ void create_zim(const zim::Metadata& metadata)
       zimCreator.add_redirectArticles_from_file(redirectsPath);
     }
   }
+  progress.start("finalization");
   zimCreator.finishZimCreation();
 }
 
@@ -0,0 +1,152 @@
+#define ZIM_PRIVATE
+#include "gtest/gtest.h"
+
+#include "../src/cluster_pipeline.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const std::string WIKIBOOKS_ZIM = "data/zimfiles/wikibooks_be_all_nopic_2017-02.zim";
+
+std::vector<zim::entry_index_type> efficientOrder(const zim::Archive& archive)
+{
+    std::vector<zim::entry_index_type> indices;
+    for (const auto& entry : archive.iterEfficient()) {
+        indices.push_back(entry.getIndex());
+    }
+    return indices;
+}
+
+std::vector<ClusterPipeline::Group> readAll(const zim::Archive& archive, ClusterPipeline::Options options)
+{
+    std::vector<ClusterPipeline::Group> groups;
+    ClusterPipeline pipeline(archive, options);
+    ClusterPipeline::Group group;
+    while (pipeline.next(group)) {
+        groups.push_back(group);
+    }
+    return groups;
+}
+
+} // unnamed namespace
+
+TEST(ClusterRangesTest, rangesCoverTheClusters) {
+    zim::Archive archive(WIKIBOOKS_ZIM);
+    ClusterRanges ranges(archive);
+    ASSERT_EQ(archive.getClusterCount(), ranges.count());
+
+    uint64_t total = 0;
+    for (zim::cluster_index_type c = 0; c < ranges.count(); ++c) {
+        EXPECT_EQ(archive.getClusterOffset(c), ranges.offset(c));
+        EXPECT_GT(ranges.size(c), 0U);
+        EXPECT_LE(ranges.offset(c) + ranges.size(c), archive.getFilesize() - 16);
+        total += ranges.size(c);
+    }
+    EXPECT_LT(total, archive.getFilesize());
+}
+
+TEST(ClusterPipelineTest, entriesInEfficientOrder) {
+    zim::Archive archive(WIKIBOOKS_ZIM);
+    for (unsigned helperThreads : {0, 1, 4}) {
+        ClusterPipeline::Options options;
+        options.helper_threads = helperThreads;
+        std::vector<zim::entry_index_type> indices;
+        for (const auto& group : readAll(archive, options)) {
+            ASSERT_FALSE(group.entries.empty());
+            for (const auto& entry : group.entries) {
+                const auto cluster = entry.isRedirect() ? 0 : entry.getItem().getClusterIndex();
+                EXPECT_EQ(group.cluster, cluster);
+                indices.push_back(entry.getIndex());
+            }
+        }
+        EXPECT_EQ(efficientOrder(archive), indices) << helperThreads;
+    }
+}
+
+TEST(ClusterPipelineTest, groupsAreBounded) {
+    // The redirections (and the entries of the big clusters) are split into
+    // several groups
+    zim::Archive archive(WIKIBOOKS_ZIM);
+    for (size_t maxGroupEntries : {1, 2, 3}) {
+        ClusterPipeline::Options options;
+        options.helper_threads = 2;
+        options.max_group_entries = maxGroupEntries;
+        std::vector<zim::entry_index_type> indices;
+        size_t redirectGroupCount = 0;
+        for (const auto& group : readAll(archive, options)) {
+            ASSERT_FALSE(group.entries.empty());
+            ASSERT_LE(group.entries.size(), maxGroupEntries);
+            ASSERT_EQ(group.entries.size(), group.blobs.size());
+            bool redirects = false;
+            for (const auto& entry : group.entries) {
+                const auto cluster = entry.isRedirect() ? 0 : entry.getItem().getClusterIndex();
+                EXPECT_EQ(group.cluster, cluster);
+                redirects = redirects || entry.isRedirect();
+                indices.push_back(entry.getIndex());
+            }
+            redirectGroupCount += redirects;
+        }
+        EXPECT_EQ(efficientOrder(archive), indices) << maxGroupEntries;
+        EXPECT_GT(redirectGroupCount, 1U) << maxGroupEntries;
+    }
+}
+
+TEST(ClusterPipelineTest, blobsHoldTheContent) {
+    zim::Archive archive(WIKIBOOKS_ZIM);
+    ClusterPipeline::Options options;
+    options.helper_threads = 3;
+    options.lookahead = 1;
+    size_t itemCount = 0;
+    for (const auto& group : readAll(archive, options)) {
+        ASSERT_EQ(group.entries.size(), group.blobs.size());
+        for (size_t i = 0; i < group.entries.size(); ++i) {
+            const auto& entry = group.entries[i];
+            if (entry.isRedirect()) {
+                EXPECT_EQ(0U, group.blobs[i].size());
+                continue;
+            }
+            EXPECT_EQ(std::string(entry.getItem().getData()), std::string(group.blobs[i]));
+            ++itemCount;
+        }
+    }
+    EXPECT_GT(itemCount, 0U);
+}
+
+TEST(ClusterPipelineTest, noBlobsWithoutHelperThreads) {
+    zim::Archive archive(WIKIBOOKS_ZIM);
+    ClusterPipeline::Options options;
+    options.helper_threads = 0;
+    for (const auto& group : readAll(archive, options)) {
+        EXPECT_TRUE(group.blobs.empty());
+    }
+}
+
+TEST(ClusterPipelineTest, filterSelectsTheItems) {
+    zim::Archive archive(WIKIBOOKS_ZIM);
+    ClusterPipeline::Options options;
+    options.filter = [](const zim::Item& item) { return item.getMimetype() == "text/html"; };
+    size_t htmlCount = 0;
+    for (const auto& group : readAll(archive, options)) {
+        for (size_t i = 0; i < group.entries.size(); ++i) {
+            const auto& entry = group.entries[i];
+            if (!entry.isRedirect() && entry.getItem().getMimetype() == "text/html") {
+                EXPECT_EQ(entry.getItem().getSize(), group.blobs[i].size());
+                ++htmlCount;
+            } else {
+                EXPECT_EQ(0U, group.blobs[i].size());
+            }
+        }
+    }
+    EXPECT_GT(htmlCount, 0U);
+}
+
+TEST(ClusterPipelineTest, stopsBeforeTheEnd) {
+    zim::Archive archive(WIKIBOOKS_ZIM);
+    ClusterPipeline pipeline(archive);
+    ClusterPipeline::Group group;
+    ASSERT_TRUE(pipeline.next(group));
+    // The destructor stops the helper threads still working ahead
+}
@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+
+#include "../src/concurrent_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ConcurrentCacheTest, getOrPut) {
+    zim::ConcurrentCache<int, int> cache(16);
+    int calls = 0;
+    const auto f = [&calls]() { ++calls; return 777; };
+
+    EXPECT_EQ(777, cache.getOrPut(7, f));
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(777, cache.getOrPut(7, f));
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(777, cache.getOrPut(8, f));
+    EXPECT_EQ(2, calls);
+}
+
+TEST(ConcurrentCacheTest, capacityIsBounded) {
+    zim::ConcurrentCache<int, int> cache(64, 4);
+    int calls = 0;
+    for (int i = 0; i < 1000; ++i) {
+        cache.getOrPut(i, [&calls, i]() { ++calls; return i; });
+    }
+    EXPECT_EQ(1000, calls);
+
+    // Only a fraction of the keys are still in the cache
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(i, cache.getOrPut(i, [&calls, i]() { ++calls; return i; }));
+    }
+    EXPECT_GT(calls, 1000 + 1000 - 64 - 1);
+}
+
+TEST(ConcurrentCacheTest, failedComputationIsNotCached) {
+    zim::ConcurrentCache<std::string, int> cache(16);
+    EXPECT_THROW(
+        cache.getOrPut("a", []() -> int { throw std::runtime_error("failed"); }),
+        std::runtime_error);
+
+    EXPECT_EQ(1, cache.getOrPut("a", []() { return 1; }));
+}
+
+TEST(ConcurrentCacheTest, failedComputationWithNonStandardException) {
+    zim::ConcurrentCache<int, int> cache(16);
+    std::atomic<bool> started(false);
+
+    std::thread t([&]() {
+        EXPECT_THROW(cache.getOrPut(1, [&]() -> int {
+            started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            throw 7;
+        }), int);
+    });
+
+    while (!started) {
+        std::this_thread::yield();
+    }
+
+    // The waiting thread gets the exception instead of a broken promise
+    EXPECT_THROW(cache.getOrPut(1, []() { return 0; }), int);
+    t.join();
+
+    // and the failure is not cached
+    EXPECT_EQ(1, cache.getOrPut(1, []() { return 1; }));
+}
+
+TEST(ConcurrentCacheTest, concurrentMissesComputeTheValueOnce) {
+    zim::ConcurrentCache<int, int> cache(16);
+    std::atomic<int> calls(0);
+    std::atomic<bool> started(false);
+
+    std::thread t([&]() {
+        const int v = cache.getOrPut(1, [&]() {
+            ++calls;
+            started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            return 42;
+        });
+        EXPECT_EQ(42, v);
+    });
+
+    while (!started) {
+        std::this_thread::yield();
+    }
+
+    // Blocks until the first thread has computed the value
+    EXPECT_EQ(42, cache.getOrPut(1, [&]() { ++calls; return 0; }));
+
+    // Other keys are not blocked meanwhile
+    EXPECT_EQ(2, cache.getOrPut(2, []() { return 2; }));
+
+    t.join();
+    EXPECT_EQ(1, calls);
+}
+
+TEST(ConcurrentCacheTest, concurrentAccess) {
+    zim::ConcurrentCache<std::string, size_t> cache(256);
+    std::atomic<size_t> errors(0);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 8; ++t) {
+        threads.emplace_back([&cache, &errors, t]() {
+            for (size_t i = 0; i < 20000; ++i) {
+                const size_t k = (i * 31 + t * 7) % 1000;
+                const size_t v = cache.getOrPut(std::to_string(k), [k]() { return k * k; });
+                if (v != k * k) {
+                    ++errors;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(0U, errors.load());
+}
@@ -0,0 +1,62 @@
+/*
+ * Microbenchmark of the rendering of the messages of zimcheck, in text and
+ * JSON formats.
+ *
+ * Run with `meson test --benchmark` (or directly) and compare the reported
+ * throughputs.
+ */
+
+#include "../src/zimcheck/checks.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+const size_t MSG_COUNT = 1000000;
+
+void run(const char* name, OutputFormat format)
+{
+  std::ostringstream output;
+  const auto start = std::chrono::steady_clock::now();
+  {
+    ErrorLogger logger(format, output);
+    for (size_t i = 0; i < MSG_COUNT; ++i) {
+      const std::string path = "A/Some_article_about_topic_" + std::to_string(i);
+      switch (i % 3) {
+      case 0:
+        logger.addMsg(MsgId::EXTERNAL_LINK, {"https://example.com/image.png", path});
+        break;
+      case 1:
+        logger.addMsg(MsgId::EMPTY_LINKS, {std::to_string(i % 10), path});
+        break;
+      case 2:
+        logger.addMsg(MsgId::DANGLING_LINKS, MsgParams({path, "A/Missing"}, {"../Missing", "Missing"}));
+        break;
+      }
+    }
+    logger.report(true);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << std::setw(10) << name
+            << std::fixed << std::setprecision(2)
+            << std::setw(10) << elapsed.count() << "s"
+            << std::setw(14) << output.str().size() / 1e6 << "MB" << std::endl;
+}
+
+} // unnamed namespace
+
+int main()
+{
+  std::cout << "Rendering of " << MSG_COUNT << " messages" << std::endl;
+  for (int i = 0; i < 2; ++i) {
+    run("text", OutputFormat::TEXT);
+    run("json", OutputFormat::JSON);
+    run("ndjson", OutputFormat::NDJSON);
+  }
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+
+#include "../src/zimcheck/external_sort.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+struct Item
+{
+    uint32_t key;
+    uint32_t value;
+
+    bool operator<(const Item& other) const
+    {
+        return key < other.key || (key == other.key && value < other.value);
+    }
+
+    bool operator==(const Item& other) const
+    {
+        return key == other.key && value == other.value;
+    }
+};
+
+std::vector<Item> mergeAll(std::vector<SortedRuns<Item>>& sources, size_t readBufferItems)
+{
+    std::vector<SortedRuns<Item>*> pointers;
+    for (auto& s : sources)
+        pointers.push_back(&s);
+    SortedRunMerger<Item> merger(pointers, readBufferItems);
+    std::vector<Item> result;
+    Item item;
+    while (merger.next(item))
+        result.push_back(item);
+    return result;
+}
+
+} // unnamed namespace
+
+TEST(ExternalSortTest, inMemory) {
+    std::vector<SortedRuns<Item>> sources(2);
+    sources[0].add({3, 0});
+    sources[0].add({1, 0});
+    sources[1].add({2, 0});
+    sources[1].add({1, 1});
+    EXPECT_EQ(0U, sources[0].spilledRunCount());
+    EXPECT_EQ(std::vector<Item>({{1, 0}, {1, 1}, {2, 0}, {3, 0}}), mergeAll(sources, 16));
+}
+
+TEST(ExternalSortTest, empty) {
+    std::vector<SortedRuns<Item>> sources(3);
+    EXPECT_TRUE(mergeAll(sources, 16).empty());
+}
+
+TEST(ExternalSortTest, spilledRuns) {
+    std::mt19937 random(42);
+    std::vector<Item> expected;
+    std::vector<SortedRuns<Item>> sources;
+    for (size_t maxBuffered : {1, 7, 100, 1000000}) {
+        sources.emplace_back(maxBuffered);
+        for (uint32_t i = 0; i < 1000; ++i) {
+            const Item item{uint32_t(random() % 300), i};
+            sources.back().add(item);
+            expected.push_back(item);
+        }
+    }
+    EXPECT_EQ(1000U, sources[0].spilledRunCount());
+    EXPECT_EQ(142U, sources[1].spilledRunCount());
+    EXPECT_EQ(10U, sources[2].spilledRunCount());
+    EXPECT_EQ(0U, sources[3].spilledRunCount());
+    EXPECT_EQ(1000U, sources[1].size());
+
+    std::sort(expected.begin(), expected.end());
+    for (size_t readBufferItems : {1, 3, 4096}) {
+        EXPECT_EQ(expected, mergeAll(sources, readBufferItems)) << readBufferItems;
+    }
+}
@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+
+#include "../src/zimcheck/link_graph.h"
+#include "../src/zimcheck/worker_pool.h"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+typedef LinkGraph::Node Node;
+
+std::vector<Node> targetsOf(const LinkGraph& graph, Node node)
+{
+    return std::vector<Node>(graph.beginTargets(node), graph.endTargets(node));
+}
+
+// 0 -> 1, 2 ; 1 -> 2 ; 2 -> 0 ; 3 -> 4 ; 5 (no links)
+// collected by two threads
+LinkGraph smallGraph()
+{
+    LinkGraph::Part part1, part2;
+    std::vector<Node> targets;
+    targets = {2, 1, 2};
+    part1.add(0, targets);
+    targets = {4};
+    part1.add(3, targets);
+    targets = {0};
+    part2.add(2, targets);
+    targets = {2};
+    part2.add(1, targets);
+    targets = {};
+    part2.add(5, targets);
+    return LinkGraph(6, {&part1, &part2});
+}
+
+} // unnamed namespace
+
+TEST(LinkGraphTest, build) {
+    const LinkGraph graph = smallGraph();
+    EXPECT_EQ(6U, graph.nodeCount());
+    EXPECT_EQ(5U, graph.linkCount());
+    EXPECT_EQ(std::vector<Node>({1, 2}), targetsOf(graph, 0));
+    EXPECT_EQ(std::vector<Node>({2}), targetsOf(graph, 1));
+    EXPECT_EQ(std::vector<Node>({0}), targetsOf(graph, 2));
+    EXPECT_EQ(std::vector<Node>({4}), targetsOf(graph, 3));
+    EXPECT_EQ(std::vector<Node>(), targetsOf(graph, 4));
+    EXPECT_EQ(std::vector<Node>(), targetsOf(graph, 5));
+    EXPECT_EQ(std::vector<uint32_t>({1, 1, 2, 0, 1, 0}), graph.inDegrees());
+}
+
+TEST(LinkGraphTest, reachableFrom) {
+    const LinkGraph graph = smallGraph();
+    WorkerPool workerPool(4);
+    EXPECT_EQ(std::vector<bool>({true, true, true, false, false, false}), graph.reachableFrom(1));
+    EXPECT_EQ(std::vector<bool>({false, false, false, true, true, false}), graph.reachableFrom(3, &workerPool));
+    EXPECT_EQ(std::vector<bool>({false, false, false, false, false, true}), graph.reachableFrom(5, &workerPool));
+}
+
+TEST(LinkGraphTest, parallelReachability) {
+    // A binary tree of 100000 nodes (whose frontiers are large enough to
+    // be explored in parallel) plus some unreachable nodes
+    const Node N = 100000;
+    LinkGraph::Part part;
+    std::vector<Node> targets;
+    for (Node n = 0; 2 * n + 1 < N; ++n) {
+        targets = {2 * n + 1};
+        if (2 * n + 2 < N)
+            targets.push_back(2 * n + 2);
+        part.add(n, targets);
+    }
+    targets = {0};
+    part.add(N + 1, targets);
+    const LinkGraph graph(N + 2, {&part});
+
+    for (unsigned threadCount : {0, 1, 2, 8}) {
+        std::unique_ptr<WorkerPool> workerPool;
+        if (threadCount)
+            workerPool = std::make_unique<WorkerPool>(threadCount);
+        const auto reachable = graph.reachableFrom(0, workerPool.get());
+        size_t count = 0;
+        for (bool r : reachable)
+            count += r;
+        EXPECT_EQ(N, count) << threadCount;
+        EXPECT_FALSE(reachable[N]);
+        EXPECT_FALSE(reachable[N + 1]);
+    }
+}
+
+TEST(LinkGraphTest, writeAndRead) {
+    const std::string path = "linkgraph-test.tmp";
+    LinkGraph::Part part;
+    std::vector<Node> targets = {7, 300, 70000, 5000000};
+    part.add(1, targets);
+    targets = {0};
+    part.add(5000000, targets);
+    const LinkGraph graph(5000001, {&part});
+    graph.write(path);
+
+    const LinkGraph copy = LinkGraph::read(path);
+    EXPECT_EQ(graph.nodeCount(), copy.nodeCount());
+    EXPECT_EQ(graph.linkCount(), copy.linkCount());
+    EXPECT_EQ(std::vector<Node>({7, 300, 70000, 5000000}), targetsOf(copy, 1));
+    EXPECT_EQ(std::vector<Node>({0}), targetsOf(copy, 5000000));
+    EXPECT_EQ(std::vector<Node>(), targetsOf(copy, 2));
+
+    // 8 bytes of offset per node dominate, the links take 1+2+3+4+1 bytes
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    EXPECT_EQ(40 + 8 * 5000002 + 11, in.tellg());
+    in.close();
+    std::remove(path.c_str());
+}
+
+TEST(LinkGraphTest, readInvalidFile) {
+    const std::string path = "linkgraph-test-invalid.tmp";
+    smallGraph().write(path);
+    std::string content;
+    {
+        std::ifstream in(path, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    for (size_t size : {size_t(0), size_t(7), size_t(40), content.size() - 1}) {
+        std::ofstream(path, std::ios::binary | std::ios::trunc).write(content.data(), size);
+        EXPECT_THROW(LinkGraph::read(path), std::runtime_error) << size;
+    }
+    std::remove(path.c_str());
+    EXPECT_THROW(LinkGraph::read(path), std::runtime_error);
+}
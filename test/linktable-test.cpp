@@ -0,0 +1,176 @@
+#include "gtest/gtest.h"
+
+#include "../src/zimcheck/link_table.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(LinkTableTest, intern) {
+    LinkTable table(1024 * 1024);
+    int calls = 0;
+    const auto length = [&calls](const std::string& link) { ++calls; return LinkTable::Target(link.size()); };
+
+    LinkTable::Link a, b, c;
+    ASSERT_TRUE(table.intern("A/a", a, length));
+    EXPECT_TRUE(a.resolved);
+    EXPECT_EQ(3, a.target);
+    ASSERT_TRUE(table.intern("A/bb", b, length));
+    EXPECT_TRUE(b.resolved);
+    EXPECT_EQ(4, b.target);
+    EXPECT_NE(a.id, b.id);
+
+    ASSERT_TRUE(table.intern(std::string("A/a"), c, length));
+    EXPECT_FALSE(c.resolved);
+    EXPECT_EQ(a.id, c.id);
+    EXPECT_EQ(3, c.target);
+
+    EXPECT_EQ(2, calls);
+    EXPECT_EQ(2U, table.size());
+    EXPECT_EQ("A/a", table.link(a.id));
+    EXPECT_EQ("A/bb", table.link(b.id));
+}
+
+TEST(LinkTableTest, memoryLimit) {
+    LinkTable table(1000);
+    const auto zero = [](const std::string&) { return LinkTable::Target(0); };
+    LinkTable::Link l;
+    size_t count = 0;
+    while (table.intern("link" + std::to_string(count), l, zero))
+        ++count;
+    EXPECT_GT(count, 0U);
+    EXPECT_LT(count, 10U);
+    EXPECT_EQ(count, table.size());
+    EXPECT_LE(table.memoryUsage(), 1000U);
+
+    // The interned links are still found
+    EXPECT_TRUE(table.intern("link0", l, zero));
+    EXPECT_FALSE(l.resolved);
+}
+
+TEST(LinkTableTest, memoryOfBlocksAndBuckets) {
+    const auto zero = [](const std::string&) { return LinkTable::Target(0); };
+    LinkTable::Link l;
+
+    // The block storing the text of a link is accounted, not only the text
+    LinkTable small(1024 * 1024);
+    ASSERT_TRUE(small.intern("A/a", l, zero));
+    EXPECT_GE(small.memoryUsage(), 256U);
+
+    // Filled up to its limit, the table doesn't use more memory than the
+    // blocks and the buckets accounted
+    const size_t maxMemory = 4 * 1024 * 1024;
+    LinkTable table(maxMemory);
+    size_t count = 0, textSize = 0;
+    std::string link;
+    while (table.intern(link = "A/link" + std::to_string(count), l, zero)) {
+        ++count;
+        textSize += link.size();
+    }
+    EXPECT_LE(table.memoryUsage(), maxMemory);
+    EXPECT_GT(table.memoryUsage(), maxMemory - 64 * 1024);
+    EXPECT_GE(table.memoryUsage(), count * (96 + sizeof(void*)) + textSize);
+}
+
+TEST(LinkTableTest, longLinks) {
+    LinkTable table(10 * 1024 * 1024);
+    const auto zero = [](const std::string&) { return LinkTable::Target(0); };
+    std::vector<std::string> links;
+    std::vector<LinkTable::Id> ids;
+    for (size_t size : {1, 100000, 10, 70000, 65536}) {
+        links.push_back(std::string(size, 'a' + links.size()));
+        LinkTable::Link l;
+        ASSERT_TRUE(table.intern(links.back(), l, zero));
+        ids.push_back(l.id);
+    }
+    for (size_t i = 0; i < links.size(); ++i)
+        EXPECT_EQ(links[i], table.link(ids[i])) << i;
+}
+
+TEST(LinkTableTest, concurrentInternResolvesOnce) {
+    LinkTable table(64 * 1024 * 1024);
+    std::atomic<int> calls{0};
+    const auto resolve = [&calls](const std::string& link) {
+        ++calls;
+        std::this_thread::yield();
+        return LinkTable::Target(std::stoi(link.substr(2)));
+    };
+
+    const int LINK_COUNT = 1000;
+    std::vector<std::thread> threads;
+    std::atomic<int> errors{0};
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&table, &resolve, &errors, t]() {
+            for (int i = 0; i < 10 * LINK_COUNT; ++i) {
+                const int n = (i * 7 + t) % LINK_COUNT;
+                LinkTable::Link l;
+                if (!table.intern("A/" + std::to_string(n), l, resolve) || l.target != n)
+                    ++errors;
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    EXPECT_EQ(0, errors);
+    EXPECT_EQ(LINK_COUNT, calls);
+    EXPECT_EQ(size_t(LINK_COUNT), table.size());
+}
+
+TEST(LinkTableTest, failedResolution) {
+    LinkTable table(1024 * 1024);
+    LinkTable::Link l;
+    EXPECT_THROW(table.intern("A/a", l, [](const std::string&) -> LinkTable::Target {
+        throw std::runtime_error("oops");
+    }), std::runtime_error);
+
+    // The failure is remembered
+    EXPECT_THROW(table.intern("A/a", l, [](const std::string&) { return LinkTable::Target(0); }),
+                 std::runtime_error);
+}
+
+TEST(LinkTableTest, waitForSlowResolution) {
+    LinkTable table(1024 * 1024);
+    for (bool failure : {false, true}) {
+        const std::string link = failure ? "A/failure" : "A/success";
+        std::atomic<bool> resolving{false};
+        std::thread resolver([&]() {
+            LinkTable::Link l;
+            try {
+                table.intern(link, l, [&](const std::string&) -> LinkTable::Target {
+                    resolving = true;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    if (failure)
+                        throw std::runtime_error("oops");
+                    return 42;
+                });
+            } catch (const std::runtime_error&) {}
+        });
+        while (!resolving)
+            std::this_thread::yield();
+
+        // These threads wait for the resolver
+        std::vector<std::thread> threads;
+        std::atomic<int> results{0}, errors{0};
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&]() {
+                LinkTable::Link l;
+                try {
+                    const bool found = table.intern(link, l, [](const std::string&) { return LinkTable::Target(0); });
+                    if (found && !l.resolved && l.target == 42)
+                        ++results;
+                } catch (const std::runtime_error&) {
+                    ++errors;
+                }
+            });
+        }
+        resolver.join();
+        for (auto& t : threads)
+            t.join();
+        EXPECT_EQ(failure ? 0 : 4, results) << link;
+        EXPECT_EQ(failure ? 4 : 0, errors) << link;
+    }
+}
@@ -0,0 +1,116 @@
+/*
+ * Microbenchmark of zim::lru_cache against the former std::list + std::map
+ * based implementation, at the size of the link status cache of zimcheck.
+ *
+ * Run with `meson test --benchmark` (or directly) and compare the reported
+ * throughputs.
+ */
+
+#include "../src/lrucache.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// The former implementation of zim::lru_cache (getOrPut() only)
+template<typename key_t, typename value_t>
+class legacy_lru_cache {
+public:
+  explicit legacy_lru_cache(size_t max_size) : _max_size(max_size) {}
+
+  bool getOrPut(const key_t& key, const value_t& value) {
+    auto it = _cache_items_map.find(key);
+    if (it != _cache_items_map.end()) {
+      _cache_items_list.splice(_cache_items_list.begin(), _cache_items_list, it->second);
+      return true;
+    }
+    _cache_items_list.push_front(std::make_pair(key, value));
+    _cache_items_map[key] = _cache_items_list.begin();
+    if (_cache_items_map.size() > _max_size) {
+      _cache_items_map.erase(_cache_items_list.back().first);
+      _cache_items_list.pop_back();
+    }
+    return false;
+  }
+
+private:
+  typedef std::list<std::pair<key_t, value_t>> list_t;
+  list_t _cache_items_list;
+  std::map<key_t, typename list_t::iterator> _cache_items_map;
+  size_t _max_size;
+};
+
+const size_t CACHE_SIZE = 64 * 1024;
+
+// Keys resembling the paths of the entries of a ZIM file
+std::vector<std::string> makeKeys(size_t n)
+{
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < n; ++i) {
+    keys.push_back("A/Some_article_about_topic_" + std::to_string(i * 7919 % n));
+  }
+  return keys;
+}
+
+// Sequence of accesses where some keys are far more frequent than others
+std::vector<size_t> makeAccesses(size_t keyCount, size_t n)
+{
+  std::mt19937 rng(42);
+  std::exponential_distribution<double> dist(4.0 / keyCount);
+  std::vector<size_t> accesses;
+  for (size_t i = 0; i < n; ++i) {
+    accesses.push_back(size_t(dist(rng)) % keyCount);
+  }
+  return accesses;
+}
+
+template<class Cache>
+void run(const char* name, const std::vector<std::string>& keys, const std::vector<size_t>& accesses)
+{
+  Cache cache(CACHE_SIZE);
+  size_t hits = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (const size_t k : accesses) {
+    hits += bool(cache.getOrPut(keys[k], true));
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << std::setw(10) << name
+            << std::fixed << std::setprecision(2)
+            << std::setw(14) << accesses.size() / elapsed.count() / 1e6
+            << std::setw(10) << 100.0 * hits / accesses.size() << "%" << std::endl;
+}
+
+// Adapts zim::lru_cache to the interface of legacy_lru_cache
+struct flat_lru_cache : zim::lru_cache<std::string, bool>
+{
+  explicit flat_lru_cache(size_t max_size) : zim::lru_cache<std::string, bool>(max_size) {}
+
+  bool getOrPut(const std::string& key, bool value) {
+    return zim::lru_cache<std::string, bool>::getOrPut(key, value).hit();
+  }
+};
+
+} // unnamed namespace
+
+int main()
+{
+  const auto keys = makeKeys(4 * CACHE_SIZE);
+  const auto accesses = makeAccesses(keys.size(), 4000000);
+
+  std::cout << std::setw(10) << "cache"
+            << std::setw(14) << "Maccesses/s"
+            << std::setw(11) << "hits" << std::endl;
+  for (int i = 0; i < 2; ++i) {
+    run<legacy_lru_cache<std::string, bool>>("legacy", keys, accesses);
+    run<flat_lru_cache>("flat", keys, accesses);
+  }
+  return 0;
+}
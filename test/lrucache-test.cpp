@@ -0,0 +1,188 @@
+#include "gtest/gtest.h"
+
+#include "../src/lrucache.h"
+
+#include <list>
+#include <map>
+#include <random>
+#include <string>
+
+const int NUM_OF_TEST2_RECORDS = 100;
+const int TEST2_CACHE_CAPACITY = 50;
+
+TEST(CacheTest, SimplePut) {
+    zim::lru_cache<int, int> cache_lru(1);
+    cache_lru.put(7, 777);
+    EXPECT_TRUE(cache_lru.exists(7));
+    EXPECT_EQ(777, cache_lru.get(7));
+    EXPECT_EQ(1U, cache_lru.size());
+}
+
+TEST(CacheTest, OverwritingPut) {
+    zim::lru_cache<int, int> cache_lru(1);
+    cache_lru.put(7, 777);
+    cache_lru.put(7, 222);
+    EXPECT_TRUE(cache_lru.exists(7));
+    EXPECT_EQ(222, cache_lru.get(7));
+    EXPECT_EQ(1U, cache_lru.size());
+}
+
+TEST(CacheTest, MissingValue) {
+    zim::lru_cache<int, int> cache_lru(1);
+    EXPECT_TRUE(cache_lru.get(7).miss());
+    EXPECT_FALSE(cache_lru.get(7).hit());
+    EXPECT_THROW(cache_lru.get(7).value(), std::range_error);
+}
+
+TEST(CacheTest, GetOrPut) {
+    zim::lru_cache<std::string, int> cache_lru(2);
+    EXPECT_FALSE(cache_lru.getOrPut("a", 1).hit());
+    EXPECT_EQ(1, cache_lru.getOrPut("a", 2).value());
+    EXPECT_TRUE(cache_lru.getOrPut("a", 2).hit());
+    EXPECT_EQ(1U, cache_lru.size());
+}
+
+TEST(CacheTest, DropValue) {
+    zim::lru_cache<int, int> cache_lru(3);
+    cache_lru.put(7, 777);
+    cache_lru.put(8, 888);
+    cache_lru.put(9, 999);
+    EXPECT_EQ(3U, cache_lru.size());
+    EXPECT_TRUE(cache_lru.exists(7));
+    EXPECT_EQ(777, cache_lru.get(7));
+
+    EXPECT_TRUE(cache_lru.drop(7));
+
+    EXPECT_EQ(2U, cache_lru.size());
+    EXPECT_FALSE(cache_lru.exists(7));
+    EXPECT_THROW(cache_lru.get(7).value(), std::range_error);
+
+    EXPECT_FALSE(cache_lru.drop(7));
+
+    cache_lru.put(10, 1000);
+    cache_lru.put(11, 1100);
+    EXPECT_EQ(3U, cache_lru.size());
+    EXPECT_FALSE(cache_lru.exists(8));
+    EXPECT_TRUE(cache_lru.exists(9));
+}
+
+TEST(CacheTest, ZeroCapacity) {
+    zim::lru_cache<int, int> cache_lru(0);
+    cache_lru.put(7, 777);
+    EXPECT_FALSE(cache_lru.exists(7));
+    EXPECT_EQ(0U, cache_lru.size());
+    EXPECT_EQ(777, cache_lru.getOrPut(7, 777).value());
+}
+
+TEST(CacheTest, KeepsAllValuesWithinCapacity) {
+    zim::lru_cache<int, int> cache_lru(TEST2_CACHE_CAPACITY);
+
+    for (int i = 0; i < NUM_OF_TEST2_RECORDS; ++i) {
+        cache_lru.put(i, i);
+    }
+
+    for (int i = 0; i < NUM_OF_TEST2_RECORDS - TEST2_CACHE_CAPACITY; ++i) {
+        EXPECT_FALSE(cache_lru.exists(i));
+    }
+
+    for (int i = NUM_OF_TEST2_RECORDS - TEST2_CACHE_CAPACITY; i < NUM_OF_TEST2_RECORDS; ++i) {
+        EXPECT_TRUE(cache_lru.exists(i));
+        EXPECT_EQ(i, cache_lru.get(i).value());
+    }
+
+    size_t size = cache_lru.size();
+    EXPECT_EQ(TEST2_CACHE_CAPACITY, (int)size);
+}
+
+TEST(CacheTest, AccessRefreshesEntries) {
+    zim::lru_cache<int, int> cache_lru(2);
+    cache_lru.put(1, 1);
+    cache_lru.put(2, 2);
+    EXPECT_TRUE(cache_lru.get(1).hit()); // 2 is now the least recently used
+    cache_lru.put(3, 3);
+    EXPECT_TRUE(cache_lru.exists(1));
+    EXPECT_FALSE(cache_lru.exists(2));
+    EXPECT_TRUE(cache_lru.exists(3));
+
+    cache_lru.getOrPut(1, 0); // 3 is now the least recently used
+    cache_lru.put(4, 4);
+    EXPECT_TRUE(cache_lru.exists(1));
+    EXPECT_FALSE(cache_lru.exists(3));
+}
+
+// Hash function with many collisions, stressing the probing and the
+// deletion from the hash table
+struct PoorHash
+{
+    size_t operator()(int k) const { return size_t(k % 7); }
+};
+
+TEST(CacheTest, MatchesReferenceImplementation) {
+    const size_t capacity = 37;
+    zim::lru_cache<int, int, PoorHash> cache_lru(capacity);
+
+    // Reference LRU: most recently used entry at the front of the list
+    std::list<std::pair<int, int>> refList;
+    std::map<int, std::list<std::pair<int, int>>::iterator> refMap;
+    const auto refTouch = [&](int key) {
+        refList.splice(refList.begin(), refList, refMap.at(key));
+    };
+    const auto refPut = [&](int key, int value) {
+        if (refMap.count(key)) {
+            refTouch(key);
+            refList.front().second = value;
+            return;
+        }
+        refList.emplace_front(key, value);
+        refMap[key] = refList.begin();
+        if (refMap.size() > capacity) {
+            refMap.erase(refList.back().first);
+            refList.pop_back();
+        }
+    };
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> keyDist(0, 100);
+    std::uniform_int_distribution<int> opDist(0, 3);
+    for (int n = 0; n < 100000; ++n) {
+        const int key = keyDist(rng);
+        switch (opDist(rng)) {
+        case 0:
+            cache_lru.put(key, n);
+            refPut(key, n);
+            break;
+        case 1: {
+            const auto r = cache_lru.getOrPut(key, n);
+            ASSERT_EQ(r.hit(), refMap.count(key) == 1) << n;
+            if (r.hit()) {
+                ASSERT_EQ(r.value(), refMap.at(key)->second) << n;
+            }
+            refPut(key, r.value());
+            break;
+        }
+        case 2: {
+            const auto r = cache_lru.get(key);
+            ASSERT_EQ(r.hit(), refMap.count(key) == 1) << n;
+            if (r.hit()) {
+                ASSERT_EQ(r.value(), refMap.at(key)->second) << n;
+                refTouch(key);
+            }
+            break;
+        }
+        case 3: {
+            const bool refHasKey = refMap.count(key) == 1;
+            ASSERT_EQ(cache_lru.drop(key), refHasKey) << n;
+            if (refHasKey) {
+                refList.erase(refMap.at(key));
+                refMap.erase(key);
+            }
+            break;
+        }
+        }
+        ASSERT_EQ(cache_lru.size(), refMap.size()) << n;
+    }
+
+    for (int key = 0; key <= 100; ++key) {
+        ASSERT_EQ(cache_lru.exists(key), refMap.count(key) == 1) << key;
+    }
+}
@@ -217,12 +217,58 @@ TEST(tools, uriKind)
     EXPECT_EQ(UriKind::OTHER, uriKind("showlocation.cgi?geo:12.34,56.78"));
     EXPECT_EQ(UriKind::OTHER, uriKind("/xyz/javascript:console.log('hello, world!')"));
 
+    EXPECT_EQ(UriKind::XMPP, uriKind("xmpp:kelson@kiwix.org"));
+    EXPECT_EQ(UriKind::NEWS, uriKind("News:comp.os.linux.announce"));
+    EXPECT_EQ(UriKind::URN, uriKind("urn:nbn:de:bsz:24-digibib-bsz3530416370"));
+
+    EXPECT_EQ(UriKind::OTHER, uriKind("dat:x"));
+    EXPECT_EQ(UriKind::OTHER, uriKind("dota:x"));
+    EXPECT_EQ(UriKind::OTHER, uriKind("javascripts:x"));
+    EXPECT_EQ(UriKind::OTHER, uriKind("1tel:x"));
+    EXPECT_EQ(UriKind::OTHER, uriKind(":x"));
+    EXPECT_EQ(UriKind::OTHER, uriKind(""));
+
     EXPECT_EQ(UriKind::OTHER, uriKind("/"));
     EXPECT_EQ(UriKind::OTHER, uriKind("/api/data:text/plain;charset=UTF-8,qwerty"));
     EXPECT_EQ(UriKind::OTHER, uriKind("../img/logo.png"));
     EXPECT_EQ(UriKind::OTHER, uriKind("style.css"));
 }
 
+LinkClass linkClass(const std::string& link, const std::string& baseUrl, const std::string& attr = "href")
+{
+    return html_link(attr, link).classify(baseUrl);
+}
+
+TEST(tools, classifyLink)
+{
+    EXPECT_EQ(LinkClass::EMPTY, linkClass("", "A"));
+    EXPECT_EQ(LinkClass::EMPTY, linkClass("", "A", "src"));
+
+    EXPECT_EQ(LinkClass::FRAGMENT, linkClass("#section", "A"));
+    EXPECT_EQ(LinkClass::FRAGMENT, linkClass("?lang=en", "A"));
+    EXPECT_EQ(LinkClass::FRAGMENT, linkClass("#http://example.com", "A"));
+
+    EXPECT_EQ(LinkClass::INTERNAL, linkClass("style.css", "A"));
+    EXPECT_EQ(LinkClass::INTERNAL, linkClass("../I/logo.png", "A"));
+    EXPECT_EQ(LinkClass::INTERNAL, linkClass("/api/data:text/plain", "A"));
+    EXPECT_EQ(LinkClass::INTERNAL, linkClass("article#section", "A"));
+    EXPECT_EQ(LinkClass::INTERNAL, linkClass("git@github.com:openzim/zim-tools.git", "A"));
+
+    EXPECT_EQ(LinkClass::OUT_OF_BOUNDS, linkClass("../../logo.png", "A"));
+    EXPECT_EQ(LinkClass::OUT_OF_BOUNDS, linkClass("../logo.png", ""));
+    EXPECT_EQ(LinkClass::INTERNAL, linkClass("../../logo.png", "A/b"));
+
+    EXPECT_EQ(LinkClass::EXTERNAL, linkClass("https://example.com", "A"));
+    EXPECT_EQ(LinkClass::EXTERNAL, linkClass("//example.com/pic.png", "A"));
+    EXPECT_EQ(LinkClass::EXTERNAL, linkClass("MAILTO:someone@example.com", "A"));
+    EXPECT_EQ(LinkClass::EXTERNAL_RESOURCE, linkClass("https://example.com/pic.png", "A", "src"));
+    EXPECT_EQ(LinkClass::EXTERNAL_RESOURCE, linkClass("//example.com/pic.png", "A", "src"));
+    EXPECT_EQ(LinkClass::EXTERNAL_RESOURCE, linkClass("javascript:void(0)", "A", "src"));
+
+    EXPECT_EQ(LinkClass::DATA, linkClass("data:image/png;base64,AAAA", "A"));
+    EXPECT_EQ(LinkClass::DATA, linkClass("Data:image/png;base64,AAAA", "A", "src"));
+}
+
 TEST(tools, isOutofBounds)
 {
     ASSERT_FALSE(isOutofBounds("", ""));
@@ -281,12 +327,72 @@ TEST(tools, normalize_link)
     ASSERT_EQ(normalize_link("qrstuvwxyz%1", "/abcdefghijklmnop"), "/abcdefghijklmnop/qrstuvwxyz");
 }
 
+TEST(tools, normalize_link_into_buffer)
+{
+    // The link may be a slice of a larger string (e.g. of an HTML page)
+    const std::string page = "<a href=\"../a/b\">..%41/</a>";
+    const std::string_view link = std::string_view(page).substr(9, 6);
+    std::string output = "some previous content";
+
+    normalize_link(link, "/b/c", output);
+    ASSERT_EQ(output, "/b/a/b");
+
+    normalize_link(std::string_view(page).substr(17, 5), "", output);
+    ASSERT_EQ(output, "..A");
+
+    // Characters following the link are not used
+    normalize_link(std::string_view(page).substr(17, 4), "", output);
+    ASSERT_EQ(output, "..");
+
+    normalize_link(std::string_view(page).substr(17, 2), "x/y", output);
+    ASSERT_EQ(output, "x/y/..");
+}
+
 TEST(tools, addler32)
 {
     ASSERT_EQ(adler32("sdfkhewruhwe8"), 640746832);
     ASSERT_EQ(adler32("sdifjsdf"), 251593550);
     ASSERT_EQ(adler32("q"), 7471218);
     ASSERT_EQ(adler32(""), 1);
+
+    // bytes are unsigned
+    ASSERT_EQ(adler32("\xff"), 16777472);
+    ASSERT_EQ(adler32("\x80\x81"), 25362690);
+
+    // long buffers (deferred modulo reduction)
+    std::string buf;
+    for ( size_t i = 0; i < 100000; ++i ) {
+        buf.push_back(char(i * 7919 % 251 + (i % 3 == 0 ? 5 : 0)));
+    }
+    for ( size_t n : {15, 16, 17, 31, 32, 33, 5551, 5552, 5553, 65536, 100000} ) {
+        uint32_t s1 = 1, s2 = 0;
+        for ( size_t i = 0; i < n; ++i ) {
+            s1 = (s1 + (unsigned char)buf[i]) % 65521;
+            s2 = (s2 + s1) % 65521;
+        }
+        ASSERT_EQ(adler32(buf.data(), n), int((s2 << 16) | s1)) << n;
+    }
+    buf.assign(100000, '\xff');
+    ASSERT_EQ(adler32(buf), adler32(buf.data(), buf.size()));
+    ASSERT_EQ(adler32(buf), int((5274u << 16) | 12332u));
+}
+
+TEST(tools, hash128)
+{
+    const Hash128 h0 = hash128("");
+    ASSERT_EQ(h0.low, 0U);
+    ASSERT_EQ(h0.high, 0U);
+
+    const Hash128 h1 = hash128("The quick brown fox jumps over the lazy dog");
+    ASSERT_EQ(h1.low, 0xe34bbc7bbc071b6cULL);
+    ASSERT_EQ(h1.high, 0x7a433ca9c49a9347ULL);
+
+    // All tail lengths
+    const std::string s(48, 'x');
+    for ( size_t n = 1; n < s.size(); ++n ) {
+        ASSERT_NE(hash128(s.substr(0, n)), hash128(s.substr(0, n-1))) << n;
+        ASSERT_EQ(hash128(s.data(), n), hash128(s.substr(0, n))) << n;
+    }
 }
 
 TEST(tools, decodeHtmlEntities)
@@ -331,7 +437,7 @@ TEST(tools, decodeHtmlEntities)
     );
 }
 
-std::string links2Str(const std::vector<html_link>& links)
+std::string links2Str(const HtmlLinkCollection& links)
 {
     std::ostringstream oss;
     const char* sep = "";
@@ -342,8 +448,15 @@ std::string links2Str(const std::vector<html_link>& links)
     return oss.str();
 }
 
+std::string getLinks(const std::string& html)
+{
+    HtmlLinkCollection links;
+    generic_getLinks(html, links);
+    return links2Str(links);
+}
+
 #define EXPECT_LINKS(html, expectedStr) \
-        ASSERT_EQ(links2Str(generic_getLinks(html)), expectedStr)
+        ASSERT_EQ(getLinks(html), expectedStr)
 
 TEST(tools, getLinks)
 {
@@ -429,9 +542,47 @@ TEST(tools, getLinks)
       "abcd href = qwerty src={123} xyz",
       ""
     );
+
+    // Attributes appearing in the value of a link are not links
+    EXPECT_LINKS(
+      "<a href='javascript:show(\" src=\"x.png\"\");'>A</a>",
+      "{ href, javascript:show(\" src=\"x.png\"\"); }"
+    );
+
+    // An attribute without value doesn't hide the next one
+    EXPECT_LINKS(
+      R"(<img src href="a.html" alt="x=y">)",
+      "{ href, a.html }"
+    );
+
+    // Unterminated link value
+    EXPECT_LINKS(
+      R"(<a href="a.html">A</a><a href="b.html>B</a>)",
+      "{ href, a.html }"
+    );
 }
 #undef EXPECT_LINKS
 
+TEST(tools, reuseHtmlLinkCollection)
+{
+    const std::string page1 = R"(<a href="/R&amp;D">R&amp;D</a><img src="a.png">)";
+    const std::string page2 = R"(<a href="x&lt;y">x</a><a href="&quot;z&quot;">z</a>)";
+    HtmlLinkCollection links;
+
+    generic_getLinks(page1, links);
+    ASSERT_EQ(links2Str(links), "{ href, /R&D }\n{ src, a.png }");
+    ASSERT_EQ(links[1].classify(""), LinkClass::INTERNAL);
+
+    generic_getLinks(page2, links);
+    ASSERT_EQ(links2Str(links), "{ href, x<y }\n{ href, \"z\" }");
+
+    generic_getLinks(page1, links);
+    ASSERT_EQ(links2Str(links), "{ href, /R&D }\n{ src, a.png }");
+
+    generic_getLinks("", links);
+    ASSERT_TRUE(links.empty());
+}
+
 TEST(tools, httpRedirectHtml)
 {
     EXPECT_EQ(
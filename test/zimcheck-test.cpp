@@ -1,10 +1,23 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 
 #include "gtest/gtest.h"
 
 #include "zim/zim.h"
 #include "zim/archive.h"
 #include "../src/zimcheck/checks.h"
+#include "../src/zimcheck/check_scheduler.h"
+#include "../src/zimcheck/link_graph.h"
+#include "../src/zimcheck/md5.h"
+#include "../src/zimcheck/worker_pool.h"
 
 std::string getLine(std::string str) {
   std::istringstream f(str);
@@ -25,6 +38,39 @@ TEST(zimfilechecks, test_checksum)
     ASSERT_TRUE(logger.overallStatus());
 }
 
+TEST(zimfilechecks, test_checksum_in_one_pass)
+{
+    {
+      ErrorLogger logger;
+      test_checksum("data/zimfiles/good.zim", logger);
+      ASSERT_TRUE(logger.overallStatus());
+    }
+    {
+      ErrorLogger logger;
+      test_checksum("data/zimfiles/bad_checksum.zim", logger);
+      ASSERT_FALSE(logger.overallStatus());
+    }
+}
+
+TEST(zimfilechecks, md5)
+{
+    const auto md5 = [](const std::string& data, size_t chunkSize) {
+        Md5 h;
+        for ( size_t i = 0; i < data.size(); i += chunkSize )
+            h.update(data.data() + i, std::min(chunkSize, data.size() - i));
+        return Md5::toHex(h.digest());
+    };
+
+    for ( size_t chunkSize : {1, 7, 64, 1000} ) {
+      ASSERT_EQ("d41d8cd98f00b204e9800998ecf8427e", md5("", chunkSize));
+      ASSERT_EQ("0cc175b9c0f1b6a831c399e269772661", md5("a", chunkSize));
+      ASSERT_EQ("f96b697d7cb7938d525a2f31aaf161d0", md5("message digest", chunkSize));
+      ASSERT_EQ("57edf4a22be3c955ac49da2e2107b67a",
+                md5("12345678901234567890123456789012345678901234567890123456789012345678901234567890", chunkSize));
+      ASSERT_EQ("7707d6ae4e027c70eea2a935c2296f21", md5(std::string(1000000, 'a'), chunkSize));
+    }
+}
+
 TEST(zimfilechecks, test_metadata)
 {
     std::string fn = "data/zimfiles/good.zim";
@@ -95,6 +141,219 @@ TEST(zimfilechecks, test_redirect_loop_fail)
   ASSERT_FALSE(logger.overallStatus());
 }
 
+TEST(zimfilechecks, test_redirect_loop_multithreaded)
+{
+  for ( unsigned threadCount : {2, 3, 16} ) {
+    std::ostringstream output;
+    {
+      ErrorLogger logger(OutputFormat::TEXT, output);
+      zim::Archive archive_poor("data/zimfiles/poor.zim");
+      WorkerPool workerPool(threadCount);
+      test_redirect_loop(archive_poor, logger, &workerPool);
+      ASSERT_FALSE(logger.overallStatus());
+      logger.report(false);
+    }
+    ASSERT_EQ(
+      "[INFO] Checking for redirect loops..." "\n"
+      "[ERROR] Redirect loop(s) exist:" "\n"
+      "  Redirect loop exists from entry redirect_loop.html" "\n"
+      "\n"
+      "  Redirect loop exists from entry redirect_loop2.html" "\n"
+      "\n"
+      "  Redirect loop exists from entry redirect_loop3.html" "\n"
+      "\n"
+      , output.str()
+    ) << threadCount;
+  }
+}
+
+TEST(zimfilechecks, spilled_messages)
+{
+  // The messages moved to temporary files are reported the same
+  for ( const auto format : {OutputFormat::TEXT, OutputFormat::JSON} ) {
+    const auto check = [format](size_t memoryLimit) {
+      std::ostringstream output;
+      {
+        ErrorLogger logger(format, output);
+        logger.setMemoryLimit(memoryLimit);
+        zim::Archive archive_poor("data/zimfiles/poor.zim");
+        ProgressBar progress(1);
+        EnabledTests all_checks; all_checks.enableAll();
+        test_articles(archive_poor, logger, progress, all_checks);
+        test_redirect_loop(archive_poor, logger);
+        logger.report(true);
+      }
+      return output.str();
+    };
+    const std::string output = check(SIZE_MAX);
+    EXPECT_NE(std::string::npos, output.find("redirect_loop3.html")) << output;
+    EXPECT_EQ(output, check(0));
+    EXPECT_EQ(output, check(1000));
+  }
+}
+
+TEST(zimfilechecks, check_scheduler)
+{
+    ErrorLogger logger;
+    std::vector<std::string> runChecks;
+    std::mutex mutex;
+    const auto check = [&](const char* name, bool result) {
+        return [&, name, result](ErrorLogger&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            runChecks.push_back(name);
+            return result;
+        };
+    };
+
+    CheckScheduler scheduler(logger);
+    const auto a = scheduler.add(check("a", true));
+    const auto b = scheduler.add(check("b", false));
+    const auto c = scheduler.add(check("c", true), {a});
+    const auto d = scheduler.add(check("d", true), {b});
+    const auto e = scheduler.add(check("e", true), {a}, {b});
+    const auto f = scheduler.add(check("f", true), {e});
+    scheduler.run();
+
+    // e and f are cancelled by the failure of b, they are skipped unless
+    // they have started already
+    std::sort(runChecks.begin(), runChecks.end());
+    runChecks.erase(std::remove_if(runChecks.begin(), runChecks.end(),
+                                   [](const std::string& c) { return c == "e" || c == "f"; }),
+                    runChecks.end());
+    ASSERT_EQ(std::vector<std::string>({"a", "b", "c"}), runChecks);
+    ASSERT_TRUE(scheduler.cancellation(e));
+    ASSERT_TRUE(scheduler.cancellation(f));
+    ASSERT_FALSE(scheduler.cancellation(c));
+    ASSERT_TRUE(scheduler.passed(a));
+    ASSERT_FALSE(scheduler.passed(b));
+    ASSERT_TRUE(scheduler.passed(c));
+    ASSERT_FALSE(scheduler.passed(d)); // skipped
+    ASSERT_FALSE(scheduler.passed(e)); // discarded
+    ASSERT_FALSE(scheduler.passed(f)); // discarded
+}
+
+TEST(zimfilechecks, check_scheduler_cancellation)
+{
+    ErrorLogger logger;
+    CheckScheduler scheduler(logger);
+    std::atomic<bool> guardedCheckStopped{false};
+    std::atomic<bool> dependentCheckRun{false};
+
+    const auto guard = scheduler.add([](ErrorLogger&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return false;
+    });
+    CheckScheduler::CheckId guarded = 0;
+    guarded = scheduler.add([&](ErrorLogger&) {
+        // Runs until it is cancelled (or for much longer than the test)
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while ( !scheduler.cancellation(guarded) && std::chrono::steady_clock::now() < deadline )
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        guardedCheckStopped = bool(scheduler.cancellation(guarded));
+        return true;
+    }, {}, {guard});
+    const auto dependent = scheduler.add([&](ErrorLogger&) {
+        dependentCheckRun = true;
+        return true;
+    }, {guarded});
+    const auto unrelated = scheduler.add([](ErrorLogger&) { return true; });
+    scheduler.run();
+
+    ASSERT_TRUE(guardedCheckStopped);
+    ASSERT_FALSE(dependentCheckRun);
+    ASSERT_TRUE(scheduler.cancellation(dependent));
+    ASSERT_FALSE(scheduler.cancellation(unrelated));
+    ASSERT_FALSE(scheduler.passed(guarded));
+    ASSERT_TRUE(scheduler.passed(unrelated));
+}
+
+TEST(zimfilechecks, cancelled_checks)
+{
+    const std::atomic<bool> cancelled{true};
+    std::ostringstream output;
+    {
+        ErrorLogger logger(OutputFormat::TEXT, output);
+        zim::Archive archive_poor("data/zimfiles/poor.zim");
+        ProgressBar progress(1);
+        EnabledTests all_checks; all_checks.enableAll();
+        ArticleCheckOptions options;
+        options.thread_count = 2;
+        options.cancellation = &cancelled;
+        const auto stats = test_articles(archive_poor, logger, progress, all_checks, options);
+        WorkerPool workerPool(2);
+        test_redirect_loop(archive_poor, logger, &workerPool, &cancelled);
+        ASSERT_EQ(0U, stats.checked_entry_count);
+        ASSERT_TRUE(logger.overallStatus());
+        logger.report(true);
+    }
+    ASSERT_EQ(std::string::npos, output.str().find("Redundant")) << output.str();
+    ASSERT_EQ(std::string::npos, output.str().find("[ERROR]")) << output.str();
+}
+
+TEST(zimfilechecks, worker_pool_for_each_range)
+{
+    WorkerPool workerPool(3);
+    for ( size_t count : {0, 1, 99, 100, 1001} ) {
+        std::vector<std::atomic<int>> calls(count);
+        workerPool.forEachRange(count, 10, [&](size_t begin, size_t end) {
+            ASSERT_LE(end - begin, 10U);
+            for ( size_t i = begin; i < end; ++i )
+                ++calls[i];
+        });
+        for ( size_t i = 0; i < count; ++i )
+            ASSERT_EQ(1, calls[i]) << count << " " << i;
+    }
+
+    EXPECT_THROW(workerPool.forEachRange(1000, 10, [](size_t begin, size_t ) {
+        if ( begin == 500 )
+            throw std::runtime_error("failure");
+    }), std::runtime_error);
+
+    // Called from a worker of the pool itself
+    std::atomic<size_t> total{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    workerPool.submit([&](size_t ) {
+        workerPool.forEachRange(1000, 10, [&](size_t begin, size_t end) { total += end - begin; });
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        cv.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return done; });
+    ASSERT_EQ(1000U, total);
+}
+
+TEST(zimfilechecks, check_scheduler_report_order)
+{
+    std::ostringstream output;
+    {
+      ErrorLogger logger(OutputFormat::TEXT, output);
+      CheckScheduler scheduler(logger);
+      scheduler.add([](ErrorLogger& r) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+          r.infoMsg("first");
+          return true;
+      });
+      scheduler.add([](ErrorLogger& r) {
+          r.infoMsg("second");
+          r.addMsg(MsgId::MISSING_FAVICON, {});
+          return true;
+      });
+      scheduler.add([](ErrorLogger& r) -> bool {
+          throw std::runtime_error("third");
+      });
+      scheduler.add([](ErrorLogger& r) {
+          r.infoMsg("fourth");
+          return true;
+      });
+      ASSERT_THROW(scheduler.run(), std::runtime_error);
+      ASSERT_FALSE(logger.overallStatus());
+    }
+    ASSERT_EQ("first\nsecond\n", output.str());
+}
+
 class CapturedStdStream
 {
   std::ostream& stream;
@@ -134,7 +393,11 @@ const std::string zimcheck_help_message(
 R"(Zimcheck checks the quality of a ZIM file.
 
 Usage:
-  zimcheck [options] [ZIMFILE]
+  zimcheck [options] [ZIMFILE...]
+
+Several ZIM files are checked concurrently, sharing the same threads. The
+report of each file is then output in one piece (on a single line in JSON
+format).
 
 Options:
  -A --all             run all tests. Default if no flags are given.
@@ -145,21 +408,37 @@ Options:
  -F --favicon         Favicon
  -P --main            Main page
  -R --redundant       Redundant data check
+    --verify_redundant  Compare byte by byte the content of redundant items
  -U --url_internal    URL check - Internal URLs
  -X --url_external    URL check - External URLs
  -D --details         Details of error
  -B --progress        Print progress report
+ --progress_fd=<fd>   write the progress as NDJSON records to the given file descriptor
+ --progress-fd=<fd>   same as --progress_fd (as spelled by zimrecreate and zimwriterfs)
  -J --json            Output in JSON format
+ --ndjson             Output in NDJSON format (a line per message, as soon as found, then a summary line)
  -H --help            Displays Help
  -V --version         Displays software version
  -L --redirect_loop   Checks for the existence of redirect loops
  -W=<nb_thread> --threads=<nb_thread>  count of threads to utilize [default: 1]
+ --path_index_max_mb=<mb>  memory limit of the index of entry paths used by the internal URL check [default: 512]
+ --link_table_max_mb=<mb>  memory limit of the table of the distinct internal links, each of which is resolved once [default: 512]
+ --max_memory=<mb>    memory budget of the checks of a ZIM file, beyond which temporary files are used
+ --file_list=<path>   check the ZIM files listed (one per line) in the given file
+ --sample=<fraction>  check the articles of a random sample of the clusters only (fraction between 0 and 1), and estimate the error rate of the whole file
+ --time_budget=<seconds>  stop checking the articles after the given time, checking the clusters in random order
+ --cluster_cache=<path>  reuse (and update) the results of the article checks of the clusters unchanged since a previous check of the ZIM file
+ --profile            add the timings and counters of the checks to the JSON output
+ --link_graph=<path>  write the graph of the internal links to the given file, and report the orphan pages and those unreachable from the main page
 
 Examples:
  zimcheck -A wikipedia.zim
  zimcheck --checksum --redundant wikipedia.zim
  zimcheck -F -R wikipedia.zim
  zimcheck -M --favicon wikipedia.zim
+ zimcheck -J -W 8 --file_list=zimfiles.txt
+ zimcheck -U -X --sample=0.01 --time_budget=600 wikipedia.zim
+ zimcheck -A --cluster_cache=wikipedia.cache wikipedia.zim
 )");
 
 TEST(zimcheck, help)
@@ -356,9 +635,30 @@ TEST(zimcheck, article_content_goodzimfile)
     test_zimcheck_single_option(
         {
           "-0", "--empty",              // Any of these options triggers
-          "-U", "--url_internal", // checking of the article contents.
-          "-X", "--url_external"  // For a good ZIM file there is no
-        },                              // difference in the output.
+          "-X", "--url_external"  // checking of the article contents.
+        },                              // For a good ZIM file there is no
+                                        // difference in the output.
+        GOOD_ZIMFILE,
+        0,
+        expected_output,
+        EMPTY_STDERR
+    );
+}
+
+TEST(zimcheck, internal_url_check_goodzimfile)
+{
+    const std::string expected_output(
+        "[INFO] Checking zim file data/zimfiles/good.zim" "\n"
+        "[INFO] Zimcheck version is " VERSION "\n"
+        "[WARNING] Integrity check is skipped. Any detected errors may in fact be due to corrupted/invalid data.\n"
+        "[INFO] Verifying Articles' content..." "\n"
+        "  Index of entry paths: 3 entries, 1 KB" "\n"
+        "[INFO] Overall Test Status: Pass" "\n"
+        "[INFO] Total time taken by zimcheck: <3 seconds." "\n"
+    );
+
+    test_zimcheck_single_option(
+        {"-U", "--url_internal"},
         GOOD_ZIMFILE,
         0,
         expected_output,
@@ -366,6 +666,60 @@ TEST(zimcheck, article_content_goodzimfile)
     );
 }
 
+TEST(zimcheck, internal_url_check_without_path_index)
+{
+    const std::string expected_output(
+        "[INFO] Checking zim file data/zimfiles/poor.zim" "\n"
+        "[INFO] Zimcheck version is " VERSION "\n"
+        "[WARNING] Integrity check is skipped. Any detected errors may in fact be due to corrupted/invalid data.\n"
+        "[INFO] Verifying Articles' content..." "\n"
+        "  Index of entry paths not built: it needs 1 MB (limit is 0 MB)" "\n"
+        "[ERROR] Invalid internal links found:" "\n"
+        "  The following links:" "\n"
+        "- A/non_existent.html" "\n"
+        "(A/non_existent.html) were not found in article dangling_link.html" "\n"
+        "  ../../oops.html is out of bounds. Article: outofbounds_link.html" "\n"
+        "[WARNING] Empty links found:" "\n"
+        "  Found 1 empty links in article: empty_link.html" "\n"
+        "[INFO] Overall Test Status: Fail" "\n"
+        "[INFO] Total time taken by zimcheck: <3 seconds." "\n"
+    );
+
+    CapturedStdout zimcheck_output;
+    const CmdLine cmdline{"zimcheck", "-U", "--path_index_max_mb=0", POOR_ZIMFILE};
+    EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+    EXPECT_EQ(expected_output, std::string(zimcheck_output)) << cmdline;
+}
+
+TEST(zimcheck, invalid_path_index_max_mb)
+{
+    for ( const char* opt : {"--path_index_max_mb=-1", "--path_index_max_mb=0.5", "--path_index_max_mb=x", "--path_index_max_mb="} )
+    {
+        CapturedStderr zimcheck_stderr;
+        EXPECT_EQ(-1, zimcheck({"zimcheck", "-U", opt, GOOD_ZIMFILE})) << opt;
+        EXPECT_EQ(0U, std::string(zimcheck_stderr).find("Invalid value of --path_index_max_mb")) << opt;
+    }
+}
+
+TEST(zimcheck, url_internal_without_link_table)
+{
+    // The links that don't fit in the table of links are checked the same
+    const auto check = [](const CmdLine& cmdline) {
+        CapturedStdout zimcheck_output;
+        EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+        return std::string(zimcheck_output);
+    };
+    EXPECT_EQ(check({"zimcheck", "-U", "-W", "2", POOR_ZIMFILE}),
+              check({"zimcheck", "-U", "-W", "2", "--link_table_max_mb=0", POOR_ZIMFILE}));
+
+    for ( const char* opt : {"--link_table_max_mb=-1", "--link_table_max_mb=0.5", "--link_table_max_mb=x"} )
+    {
+        CapturedStderr zimcheck_stderr;
+        EXPECT_EQ(-1, zimcheck({"zimcheck", "-U", opt, GOOD_ZIMFILE})) << opt;
+        EXPECT_EQ(0U, std::string(zimcheck_stderr).find("Invalid value of --link_table_max_mb")) << opt;
+    }
+}
+
 TEST(zimcheck, redundant_articles_goodzimfile)
 {
     const std::string expected_output(
@@ -417,6 +771,7 @@ const std::string ALL_CHECKS_OUTPUT_ON_GOODZIMFILE(
       "[INFO] Searching for Favicon..." "\n"
       "[INFO] Searching for main page..." "\n"
       "[INFO] Verifying Articles' content..." "\n"
+      "  Index of entry paths: 3 entries, 1 KB" "\n"
       "[INFO] Searching for redundant articles..." "\n"
       "  Verifying Similar Articles for redundancies..." "\n"
       "[INFO] Checking for redirect loops..." "\n"
@@ -524,6 +879,21 @@ TEST(zimcheck, bad_checksum)
     );
 }
 
+TEST(zimcheck, bad_checksum_all_checks)
+{
+    // The checks of the content are stopped, and their results discarded,
+    // once the file is found corrupted
+    for ( const char* threads : {"1", "4"} ) {
+        const CmdLine cmdline{"zimcheck", "-A", "-B", "-W", threads, BAD_CHECKSUM_ZIMFILE};
+        CapturedStdout zimcheck_output;
+        ASSERT_EQ(1, zimcheck(cmdline)) << cmdline;
+        const std::string output(zimcheck_output);
+        EXPECT_EQ(std::string::npos, output.find("Verifying Articles' content")) << output;
+        EXPECT_EQ(std::string::npos, output.find("Checking for redirect loops")) << output;
+        EXPECT_NE(std::string::npos, output.find("[INFO] Overall Test Status: Fail")) << output;
+    }
+}
+
 TEST(zimcheck, metadata_poorzimfile)
 {
     const std::string expected_stdout(
@@ -623,6 +993,7 @@ TEST(zimcheck, internal_url_check_poorzimfile)
       "[INFO] Zimcheck version is " VERSION "\n"
       "[WARNING] Integrity check is skipped. Any detected errors may in fact be due to corrupted/invalid data.\n"
       "[INFO] Verifying Articles' content..." "\n"
+      "  Index of entry paths: 14 entries, 1 KB" "\n"
       "[ERROR] Invalid internal links found:" "\n"
       "  The following links:" "\n"
       "- A/non_existent.html" "\n"
@@ -691,6 +1062,29 @@ TEST(zimcheck, redundant_poorzimfile)
     );
 }
 
+TEST(zimcheck, verified_redundant_poorzimfile)
+{
+    const std::string expected_stdout(
+      "[INFO] Checking zim file data/zimfiles/poor.zim" "\n"
+      "[INFO] Zimcheck version is " VERSION "\n"
+      "[WARNING] Integrity check is skipped. Any detected errors may in fact be due to corrupted/invalid data.\n"
+      "[INFO] Verifying Articles' content..." "\n"
+      "[INFO] Searching for redundant articles..." "\n"
+      "  Verifying Similar Articles for redundancies..." "\n"
+      "[WARNING] Redundant data found:" "\n"
+      "  article1.html and redundant_article.html" "\n"
+      "[INFO] Overall Test Status: Pass" "\n"
+      "[INFO] Total time taken by zimcheck: <3 seconds." "\n"
+    );
+
+    CapturedStdout zimcheck_output;
+    CapturedStderr zimcheck_stderr;
+    const CmdLine cmdline{"zimcheck", "-R", "--verify_redundant", POOR_ZIMFILE};
+    EXPECT_EQ(0, zimcheck(cmdline)) << cmdline;
+    EXPECT_EQ(EMPTY_STDERR, std::string(zimcheck_stderr)) << cmdline;
+    EXPECT_EQ(expected_stdout, std::string(zimcheck_output)) << cmdline;
+}
+
 TEST(zimcheck, redirect_loop_poorzimfile)
 {
   const std::string expected_output(
@@ -727,6 +1121,7 @@ const std::string ALL_CHECKS_OUTPUT_ON_POORZIMFILE(
       "[INFO] Searching for Favicon..." "\n"
       "[INFO] Searching for main page..." "\n"
       "[INFO] Verifying Articles' content..." "\n"
+      "  Index of entry paths: 14 entries, 1 KB" "\n"
       "[INFO] Searching for redundant articles..." "\n"
       "  Verifying Similar Articles for redundancies..." "\n"
       "[INFO] Checking for redirect loops..." "\n"
@@ -785,6 +1180,17 @@ TEST(zimcheck, all_checks_poorzimfile)
     );
 }
 
+TEST(zimcheck, multithreaded_all_checks_poorzimfile)
+{
+    for ( const char* threadCount : {"2", "3", "8"} )
+    {
+        CapturedStdout zimcheck_output;
+        const CmdLine cmdline{"zimcheck", "-A", "-W", threadCount, POOR_ZIMFILE};
+        EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+        EXPECT_EQ(ALL_CHECKS_OUTPUT_ON_POORZIMFILE, std::string(zimcheck_output)) << cmdline;
+    }
+}
+
 TEST(zimcheck, json_bad_checksum)
 {
     CapturedStdout zimcheck_output;
@@ -817,6 +1223,385 @@ TEST(zimcheck, json_bad_checksum)
     );
 }
 
+TEST(zimcheck, json_multiple_zimfiles)
+{
+    const std::string good_zimfile_report(
+      "{"
+        "\"zimcheck_version\":\"" VERSION "\","
+        "\"checks\":[\"checksum\"],"
+        "\"file_name\":\"data/zimfiles/good.zim\","
+        "\"file_uuid\":\"00000000-0000-0000-0000-000000000000\","
+        "\"status\":true,"
+        "\"logs\":[]"
+      "}" "\n"
+    );
+    const std::string bad_checksum_report(
+      "{"
+        "\"zimcheck_version\":\"" VERSION "\","
+        "\"checks\":[\"checksum\"],"
+        "\"file_name\":\"data/zimfiles/bad_checksum.zim\","
+        "\"file_uuid\":\"00000000-0000-0000-0000-000000000000\","
+        "\"status\":false,"
+        "\"logs\":["
+          "{"
+            "\"check\":\"checksum\","
+            "\"level\":\"ERROR\","
+            "\"message\":\"ZIM Archive Checksum in archive: 00000000000000000000000000000000\\n\","
+            "\"archive_checksum\":\"00000000000000000000000000000000\""
+          "}"
+        "]"
+      "}" "\n"
+    );
+
+    {
+      CapturedStdout zimcheck_output;
+      const CmdLine cmdline{"zimcheck", "--json", "-C", GOOD_ZIMFILE, BAD_CHECKSUM_ZIMFILE};
+      EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+      EXPECT_EQ(good_zimfile_report + bad_checksum_report, std::string(zimcheck_output)) << cmdline;
+    }
+
+    // With several threads the reports are output in the order of completion
+    for ( const char* threadCount : {"2", "8"} )
+    {
+      CapturedStdout zimcheck_output;
+      const CmdLine cmdline{"zimcheck", "--json", "-C", "-W", threadCount, GOOD_ZIMFILE, BAD_CHECKSUM_ZIMFILE};
+      EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+      const std::string output(zimcheck_output);
+      EXPECT_TRUE(output == good_zimfile_report + bad_checksum_report
+               || output == bad_checksum_report + good_zimfile_report) << cmdline;
+    }
+}
+
+TEST(zimcheck, ndjson_bad_checksum)
+{
+    CapturedStdout zimcheck_output;
+    ASSERT_EQ(1, zimcheck({"zimcheck", "--ndjson", "-C", BAD_CHECKSUM_ZIMFILE}));
+
+    ASSERT_EQ(
+      "{"
+        "\"file_name\":\"data/zimfiles/bad_checksum.zim\","
+        "\"check\":\"checksum\","
+        "\"level\":\"ERROR\","
+        "\"message\":\"ZIM Archive Checksum in archive: 00000000000000000000000000000000\\n\","
+        "\"archive_checksum\":\"00000000000000000000000000000000\""
+      "}" "\n"
+      "{"
+        "\"zimcheck_version\":\"" VERSION "\","
+        "\"checks\":[\"checksum\"],"
+        "\"file_name\":\"data/zimfiles/bad_checksum.zim\","
+        "\"file_uuid\":\"00000000-0000-0000-0000-000000000000\","
+        "\"status\":false"
+      "}" "\n"
+      , std::string(zimcheck_output)
+    );
+}
+
+TEST(zimcheck, ndjson_poorzimfile)
+{
+    std::string singleThreadedOutput;
+    {
+      CapturedStdout zimcheck_output;
+      ASSERT_EQ(1, zimcheck({"zimcheck", "--ndjson", POOR_ZIMFILE}));
+      singleThreadedOutput = zimcheck_output;
+    }
+    // A line per message and the summary
+    ASSERT_EQ(19, std::count(singleThreadedOutput.begin(), singleThreadedOutput.end(), '\n'));
+
+    // The messages are output in the same order whatever the count of threads
+    for ( const char* threadCount : {"2", "8"} )
+    {
+      CapturedStdout zimcheck_output;
+      const CmdLine cmdline{"zimcheck", "--ndjson", "-W", threadCount, POOR_ZIMFILE};
+      EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+      EXPECT_EQ(singleThreadedOutput, std::string(zimcheck_output)) << cmdline;
+    }
+}
+
+TEST(zimcheck, file_list)
+{
+    const char fileList[] = "zimcheck-test-file-list.txt";
+    {
+      std::ofstream out(fileList);
+      out << GOOD_ZIMFILE << "\n\n" << POOR_ZIMFILE << "\n";
+    }
+
+    // The biggest files are checked first
+    const std::string expected_output(
+      "[INFO] Checking zim file data/zimfiles/poor.zim" "\n"
+      "[INFO] Zimcheck version is " VERSION "\n"
+      "[WARNING] Integrity check is skipped. Any detected errors may in fact be due to corrupted/invalid data.\n"
+      "[INFO] Checking for redirect loops..." "\n"
+      "[ERROR] Redirect loop(s) exist:" "\n"
+      "  Redirect loop exists from entry redirect_loop.html" "\n"
+      "" "\n"
+      "  Redirect loop exists from entry redirect_loop2.html" "\n"
+      "" "\n"
+      "  Redirect loop exists from entry redirect_loop3.html" "\n"
+      "" "\n"
+      "[INFO] Overall Test Status: Fail" "\n"
+      "[INFO] Total time taken by zimcheck: <3 seconds." "\n"
+      "[INFO] Checking zim file data/zimfiles/good.zim" "\n"
+      "[INFO] Zimcheck version is " VERSION "\n"
+      "[WARNING] Integrity check is skipped. Any detected errors may in fact be due to corrupted/invalid data.\n"
+      "[INFO] Checking for redirect loops..." "\n"
+      "[INFO] Overall Test Status: Pass" "\n"
+      "[INFO] Total time taken by zimcheck: <3 seconds." "\n"
+    );
+
+    CapturedStdout zimcheck_output;
+    CapturedStderr zimcheck_stderr;
+    const CmdLine cmdline{"zimcheck", "-L", "--file_list=zimcheck-test-file-list.txt"};
+    EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+    EXPECT_EQ(EMPTY_STDERR, std::string(zimcheck_stderr)) << cmdline;
+    EXPECT_EQ(expected_output, std::string(zimcheck_output)) << cmdline;
+
+    std::remove(fileList);
+}
+
+TEST(zimcheck, missing_file_list)
+{
+    CapturedStderr zimcheck_stderr;
+    ASSERT_EQ(-1, zimcheck({"zimcheck", "--file_list=nonexistent.txt"}));
+    ASSERT_EQ("Cannot open the file list nonexistent.txt\n", std::string(zimcheck_stderr));
+}
+
+TEST(zimcheck, sample)
+{
+    CapturedStdout zimcheck_output;
+    ASSERT_EQ(0, zimcheck({"zimcheck", "-U", "-X", "--json", "--sample=0.5", GOOD_ZIMFILE}));
+
+    const std::string output(zimcheck_output);
+    EXPECT_NE(std::string::npos, output.find("    \"cluster_count\" : 2,\n"
+                                             "    \"checked_cluster_count\" : 1,\n")) << output;
+    EXPECT_NE(std::string::npos, output.find("    \"failed_entry_count\" : 0,\n")) << output;
+}
+
+TEST(zimcheck, time_budget)
+{
+    CapturedStdout zimcheck_output;
+    ASSERT_EQ(1, zimcheck({"zimcheck", "-U", "-X", "--time_budget=1000", POOR_ZIMFILE}));
+
+    // All the clusters are checked (in random order) within the time budget
+    const std::string output(zimcheck_output);
+    EXPECT_NE(std::string::npos, output.find(
+        "  Sample: 2 of 2 clusters, 14 of 14 entries (100.00%)\n"
+        "  Entries with errors: 6 (42.86%), about 6 in the whole file\n"
+    )) << output;
+}
+
+TEST(zimcheck, invalid_sample)
+{
+    for ( const char* opt : {"--sample=0", "--sample=1.5", "--sample=x", "--time_budget=-1"} )
+    {
+        CapturedStderr zimcheck_stderr;
+        EXPECT_EQ(-1, zimcheck({"zimcheck", opt, GOOD_ZIMFILE})) << opt;
+        EXPECT_EQ(0U, std::string(zimcheck_stderr).find("Invalid value of --")) << opt;
+    }
+}
+
+TEST(zimcheck, cluster_cache)
+{
+    const char* const cacheFile = "zimcheck-test-cluster-cache.tmp";
+    std::remove(cacheFile);
+    const CmdLine cmdline{"zimcheck", "-A", "--cluster_cache=zimcheck-test-cluster-cache.tmp", POOR_ZIMFILE};
+    const auto check = [&cmdline]() {
+        CapturedStdout zimcheck_output;
+        EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+        return std::string(zimcheck_output);
+    };
+    const auto stripCacheInfo = [](std::string s) {
+        const auto pos = s.find("  Cluster cache: ");
+        return s.erase(pos, s.find('\n', pos) + 1 - pos);
+    };
+
+    const std::string output = check();
+    EXPECT_NE(std::string::npos, output.find("  Cluster cache: 0 of 2 clusters found\n")) << output;
+
+    // The second check reuses the results of the first one and reports the
+    // same errors
+    const std::string cachedOutput = check();
+    EXPECT_NE(std::string::npos, cachedOutput.find("  Cluster cache: 2 of 2 clusters found\n")) << cachedOutput;
+    EXPECT_EQ(stripCacheInfo(output), stripCacheInfo(cachedOutput));
+
+    std::remove(cacheFile);
+}
+
+TEST(zimcheck, cluster_cache_with_several_files)
+{
+    CapturedStderr zimcheck_stderr;
+    ASSERT_EQ(-1, zimcheck({"zimcheck", "--cluster_cache=cache", GOOD_ZIMFILE, POOR_ZIMFILE}));
+    ASSERT_EQ("--cluster_cache can be used with a single ZIM file only\n", std::string(zimcheck_stderr));
+}
+
+TEST(zimcheck, max_memory)
+{
+    const auto check = [](const CmdLine& cmdline) {
+        CapturedStdout zimcheck_output;
+        EXPECT_EQ(1, zimcheck(cmdline)) << cmdline;
+        return std::string(zimcheck_output);
+    };
+    // Only the index of entry paths doesn't fit in the tiny budget, the
+    // errors found are the same
+    const auto errors = [](const std::string& output) {
+        return output.substr(output.find("[INFO] Checking for redirect loops"));
+    };
+    const std::string output = check({"zimcheck", "-A", "-W", "2", "--max_memory=1", POOR_ZIMFILE});
+    EXPECT_NE(std::string::npos, output.find("Index of entry paths not built")) << output;
+    EXPECT_EQ(errors(check({"zimcheck", "-A", "-W", "2", POOR_ZIMFILE})), errors(output));
+
+    for ( const char* opt : {"--max_memory=0", "--max_memory=-1", "--max_memory=0.5", "--max_memory=x"} )
+    {
+        CapturedStderr zimcheck_stderr;
+        EXPECT_EQ(-1, zimcheck({"zimcheck", opt, GOOD_ZIMFILE})) << opt;
+        EXPECT_EQ(0U, std::string(zimcheck_stderr).find("Invalid value of --max_memory")) << opt;
+    }
+}
+
+TEST(zimcheck, link_graph)
+{
+    const char* const graphFile = "zimcheck-test-link-graph.tmp";
+    std::remove(graphFile);
+    CapturedStdout zimcheck_output;
+    ASSERT_EQ(1, zimcheck({"zimcheck", "-U", "--json", "--link_graph=zimcheck-test-link-graph.tmp", POOR_ZIMFILE}));
+
+    const std::string output(zimcheck_output);
+    EXPECT_NE(std::string::npos, output.find(
+      "  \"link_graph\" : {"                                                "\n"
+      "    \"node_count\" : 25,"                                            "\n"
+      "    \"link_count\" : 11,"                                            "\n"
+      "    \"page_count\" : 10,"                                            "\n"
+      "    \"orphan_pages\" : ["                                            "\n"
+      "      \"dangling_link.html\","                                       "\n"
+      "      \"empty.html\","                                               "\n"
+      "      \"empty_link.html\","                                          "\n"
+      "      \"external_image_http.html\","                                 "\n"
+      "      \"external_image_https.html\","                                "\n"
+      "      \"external_image_protocol_relative.html\","                    "\n"
+      "      \"main.html\","                                                "\n"
+      "      \"outofbounds_link.html\","                                    "\n"
+      "      \"redundant_article.html\""                                    "\n"
+      "    ]"                                                               "\n"
+      "  },"                                                                "\n"
+    )) << output;
+
+    // All the links are collected, the dangling ones are still reported
+    EXPECT_NE(std::string::npos, output.find("were not found in article dangling_link.html")) << output;
+
+    const LinkGraph graph = LinkGraph::read(graphFile);
+    EXPECT_EQ(25U, graph.nodeCount());
+    EXPECT_EQ(11U, graph.linkCount());
+    std::remove(graphFile);
+}
+
+TEST(zimcheck, link_graph_reachability)
+{
+    const char* const graphFile = "zimcheck-test-link-graph.tmp";
+    CapturedStdout zimcheck_output;
+    ASSERT_EQ(0, zimcheck({"zimcheck", "-U", "-W", "4", "--link_graph=zimcheck-test-link-graph.tmp",
+                           "data/zimfiles/wikibooks_be_all_nopic_2017-02.zim"}));
+
+    const std::string output(zimcheck_output);
+    EXPECT_NE(std::string::npos, output.find(
+      "  Link graph: 296 links between 118 entries written to zimcheck-test-link-graph.tmp\n"
+      "  Orphan pages: 8 of 66\n"
+      "  Pages unreachable from the main page: 38 of 66\n"
+    )) << output;
+    std::remove(graphFile);
+}
+
+TEST(zimcheck, link_graph_invalid_usage)
+{
+    const std::vector<std::pair<CmdLine, std::string>> cases{
+      {{"zimcheck", "--link_graph=graph", GOOD_ZIMFILE, POOR_ZIMFILE},
+       "--link_graph can be used with a single ZIM file only\n"},
+      {{"zimcheck", "-R", "--link_graph=graph", GOOD_ZIMFILE},
+       "--link_graph requires the internal URL check\n"},
+      {{"zimcheck", "-U", "--sample=0.5", "--link_graph=graph", GOOD_ZIMFILE},
+       "--link_graph cannot be used with --sample or --time_budget\n"},
+    };
+    for ( const auto& c : cases )
+    {
+        CapturedStderr zimcheck_stderr;
+        EXPECT_EQ(-1, zimcheck(c.first)) << c.first;
+        EXPECT_EQ(c.second, std::string(zimcheck_stderr)) << c.first;
+    }
+}
+
+TEST(zimcheck, progress_fd)
+{
+    // The option is also accepted with the spelling of zimrecreate and
+    // zimwriterfs
+    for ( const std::string option : {"--progress_fd=", "--progress-fd="} )
+    {
+        const char* const progressFile = "zimcheck-test-progress.tmp";
+        FILE* const f = std::fopen(progressFile, "w");
+        ASSERT_NE(nullptr, f);
+        const std::string fdOption = option + std::to_string(fileno(f));
+        {
+            CapturedStdout zimcheck_output;
+            ASSERT_EQ(0, zimcheck({"zimcheck", "-U", "-R", fdOption.c_str(), GOOD_ZIMFILE})) << option;
+        }
+        std::fclose(f);
+
+        // Records are written at least at the end of every phase
+        std::ifstream in(progressFile);
+        const std::string records((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        EXPECT_NE(std::string::npos, records.find(
+            "{\"name\":\"data/zimfiles/good.zim\",\"phase\":\"articles\",\"done\":3,\"total\":3,"
+        )) << records;
+        EXPECT_NE(std::string::npos, records.find(
+            "{\"name\":\"data/zimfiles/good.zim\",\"phase\":\"redundancy\","
+        )) << records;
+        EXPECT_EQ("\"finished\":true}\n", records.substr(records.size() - 17)) << records;
+
+        std::remove(progressFile);
+    }
+}
+
+TEST(zimcheck, progress_with_several_files)
+{
+    CapturedStdout zimcheck_output;
+    CapturedStderr zimcheck_stderr;
+    ASSERT_EQ(0, zimcheck({"zimcheck", "-B", "-C", GOOD_ZIMFILE, GOOD_ZIMFILE}));
+    ASSERT_EQ(
+      "[WARNING] --progress is ignored when several ZIM files are checked, use --progress_fd instead\n",
+      std::string(zimcheck_stderr)
+    );
+}
+
+TEST(zimcheck, invalid_progress_fd)
+{
+    for ( const char* opt : {"--progress_fd=-2", "--progress_fd=1.5", "--progress_fd=x"} )
+    {
+        CapturedStderr zimcheck_stderr;
+        EXPECT_EQ(-1, zimcheck({"zimcheck", opt, GOOD_ZIMFILE})) << opt;
+        EXPECT_EQ(0U, std::string(zimcheck_stderr).find("Invalid value of --progress_fd")) << opt;
+    }
+    {
+        CapturedStderr zimcheck_stderr;
+        EXPECT_EQ(-1, zimcheck({"zimcheck", "--progress-fd=x", GOOD_ZIMFILE}));
+        EXPECT_EQ("Invalid value of --progress-fd: x\n", std::string(zimcheck_stderr));
+    }
+}
+
+TEST(zimcheck, profile)
+{
+    CapturedStdout zimcheck_output;
+    ASSERT_EQ(1, zimcheck({"zimcheck", "-A", "--json", "--profile", POOR_ZIMFILE}));
+
+    // The times vary from one run to the next one, the counters don't
+    const std::string output(zimcheck_output);
+    EXPECT_NE(std::string::npos, output.find("  \"profile\" : {\n"
+                                             "    \"checks\" : {\n"
+                                             "      \"integrity_seconds\" : ")) << output;
+    EXPECT_NE(std::string::npos, output.find("      \"articles_seconds\" : ")) << output;
+    EXPECT_NE(std::string::npos, output.find("      \"link_extraction_seconds\" : ")) << output;
+    EXPECT_NE(std::string::npos, output.find("      \"read_bytes\" : 12213,\n"
+                                             "      \"hashed_bytes\" : 12213,\n"
+                                             "      \"scanned_bytes\" : 7090,\n"
+                                             "      \"link_lookups\" : 8,\n")) << output;
+}
+
 TEST(zimcheck, json_poorzimfile)
 {
     CapturedStdout zimcheck_output;